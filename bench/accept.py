@@ -0,0 +1,42 @@
+#!/usr/bin/env python3
+"""Connections per second: one acceptor against SO_REUSEPORT acceptors.
+
+Runs the server with the single acceptor, which hands every socket to a
+network thread, and with --reuse-port, where every network thread
+accepts on the port itself, in alternating rounds. Client processes
+open a connection per request and read until the server closes it.
+The gain needs several cores, on one core the modes are on par.
+
+  bench/accept.py --server build/src/rest4git --repo /path/to/repo
+"""
+
+import argparse
+
+import httpbench
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--server", required=True, help="rest4git binary")
+    parser.add_argument("--repo", required=True, help="repository to serve")
+    parser.add_argument("--port", type=int, default=8090)
+    parser.add_argument("--path", default="/branch/v2/current", help="route requested")
+    parser.add_argument("--clients", type=int, default=8)
+    parser.add_argument("--io-threads", type=int, default=4)
+    parser.add_argument("--seconds", type=float, default=10)
+    parser.add_argument("--rounds", type=int, default=3)
+    args = parser.parse_args()
+
+    print("%d clients, %d io threads, %s, one request per connection" % (args.clients, args.io_threads, args.path))
+    for _ in range(args.rounds):
+        for reuse_port in (0, 1):
+            options = ["--io-threads", str(args.io_threads), "--reuse-port=%d" % reuse_port]
+            with httpbench.Server(args.server, args.repo, args.port, options) as server:
+                httpbench.run_clients(server.port, [args.path], args.clients, 1, False)
+                rate, latencies = httpbench.run_clients(server.port, [args.path], args.clients,
+                                                        args.seconds, False)
+            httpbench.report("SO_REUSEPORT" if reuse_port else "single acceptor", rate, latencies)
+
+
+if __name__ == "__main__":
+    main()
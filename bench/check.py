@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+"""/check/v2 path lookups on a tree of 500k files.
+
+Generates a repository whose HEAD tree holds 500k paths by default, all
+pointing to one blob, with git fast-import. The server then answers
+/check/v2 queries of different selectivity. The first query builds the
+path and trigram indexes and is reported apart. Every answer is compared
+with a plain substring filter over the same paths.
+
+  bench/check.py --server build/src/rest4git --dir /tmp/check-bench
+"""
+
+import argparse
+import os
+import statistics
+import subprocess
+import sys
+import time
+
+import httpbench
+
+EXTENSIONS = [".c", ".h", ".cpp", ".py"]
+
+
+def path_of(i):
+    return "src/m%03d/d%02d/file%06d%s" % (i % 500, (i // 500) % 20, i, EXTENSIONS[i % len(EXTENSIONS)])
+
+
+def generate(path, files):
+    subprocess.check_call(["git", "init", "-q", path])
+    subprocess.check_call(["git", "-C", path, "symbolic-ref", "HEAD", "refs/heads/master"])
+    fast_import = subprocess.Popen(["git", "-C", path, "fast-import", "--quiet"], stdin=subprocess.PIPE)
+    message = "files\n"
+    out = ["blob\nmark :1\ndata 5\nfile\n\n",
+           "commit refs/heads/master\nmark :2\ncommitter Bench <bench@example.com> 1600000000 +0000\n"
+           "data %d\n%s" % (len(message), message)]
+    out += ["M 100644 :1 %s\n" % path_of(i) for i in range(files)]
+    fast_import.stdin.write("".join(out).encode())
+    fast_import.stdin.close()
+    if fast_import.wait() != 0:
+        sys.exit("git fast-import failed")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--server", required=True, help="rest4git binary")
+    parser.add_argument("--dir", required=True, help="synthetic repository, generated unless it exists")
+    parser.add_argument("--port", type=int, default=8090)
+    parser.add_argument("--files", type=int, default=500000)
+    parser.add_argument("--repeat", type=int, default=20, help="runs of each query")
+    args = parser.parse_args()
+
+    if not os.path.isdir(args.dir):
+        start = time.monotonic()
+        generate(args.dir, args.files)
+        print("generated %d files in %.1f s" % (args.files, time.monotonic() - start))
+    paths = httpbench.repo_files(args.dir)
+
+    # The route matches "/" + pattern, so patterns start at a path component.
+    queries = [
+        ("one file", path_of(args.files // 2).rsplit("/", 1)[1], 0),
+        ("one directory", "m042/", 0),
+        ("file name prefix", "file12", 0),
+        ("directories, limit 100", "d07/", 100),
+        ("directories", "d07/", 0),
+        ("short pattern", "d1", 0),
+    ]
+
+    with httpbench.Server(args.server, args.dir, args.port) as server:
+        print("%-22s %9s %10s %10s" % ("query", "matches", "p50 ms", "p90 ms"))
+        first = True
+        for label, pattern, limit in queries:
+            url = "/check/v2/" + pattern + ("?limit=%d" % limit if limit else "")
+            expected = [p for p in paths if ("/" + pattern) in p]
+            if limit:
+                expected = expected[:limit]
+            times = []
+            for _ in range(args.repeat + (1 if first else 0)):
+                elapsed, body = httpbench.timed_get(server.port, url)
+                if first:
+                    print("%-22s %9s %10.1f" % ("first (builds index)", "", elapsed * 1e3))
+                    first = False
+                    continue
+                times.append(elapsed)
+            found = body.decode().splitlines()
+            if found != expected:
+                sys.exit("%s: %d paths, expected %d" % (url, len(found), len(expected)))
+            times.sort()
+            print("%-22s %9d %10.2f %10.2f" % (label, len(found), statistics.median(times) * 1e3,
+                                                httpbench.percentile(times, 90) * 1e3))
+
+
+if __name__ == "__main__":
+    main()
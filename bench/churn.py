@@ -0,0 +1,47 @@
+#!/usr/bin/env python3
+"""Connection churn: one request per connection, like wget.
+
+Client processes connect, send one request with Connection: close and
+read the response until the server closes, in a loop. Reports requests
+per second and the time from connect() to the first byte of the
+response, with closed connections reused (--connection-pool 256) and
+without (--connection-pool 0), in alternating rounds.
+
+  bench/churn.py --server build/src/rest4git --repo /path/to/repo
+"""
+
+import argparse
+import re
+
+import httpbench
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--server", required=True, help="rest4git binary")
+    parser.add_argument("--repo", required=True, help="repository to serve")
+    parser.add_argument("--port", type=int, default=8090)
+    parser.add_argument("--path", default="/branch/v2/current", help="route requested")
+    parser.add_argument("--clients", type=int, default=8)
+    parser.add_argument("--io-threads", type=int, default=4)
+    parser.add_argument("--seconds", type=float, default=10)
+    parser.add_argument("--rounds", type=int, default=3)
+    args = parser.parse_args()
+
+    print("%d clients, %s, one request per connection" % (args.clients, args.path))
+    for _ in range(args.rounds):
+        for pool in (256, 0):
+            options = ["--io-threads", str(args.io_threads), "--connection-pool", str(pool)]
+            with httpbench.Server(args.server, args.repo, args.port, options) as server:
+                # Warm-up, fills the caches and the connection pools.
+                httpbench.run_clients(server.port, [args.path], args.clients, 1, False)
+                rate, latencies = httpbench.run_clients(server.port, [args.path], args.clients,
+                                                        args.seconds, False)
+                _, stats = httpbench.get(server.port, "/cache/v2")
+            reused = re.search(r"^connections\s+reused (\d+)", stats.decode(), re.M)
+            label = "pool %d, reused %s" % (pool, reused.group(1) if reused else "?")
+            httpbench.report(label, rate, latencies)
+
+
+if __name__ == "__main__":
+    main()
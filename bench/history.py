@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+"""File histories from the path history index against the commit walk.
+
+Generates a synthetic repository with git fast-import, 100k first-parent
+commits over 5000 files by default, half of the changes going to a few
+hot files. The same server binary then answers /commit/oneline/v2 of hot
+and cold files twice: with REST4GIT_HISTORY=0, walking the commits, and
+with the index, after it has been built. Every request is sent once per
+run, so the log cache does not answer it.
+
+  bench/history.py --server build/src/rest4git --dir /tmp/history-bench
+"""
+
+import argparse
+import os
+import random
+import re
+import statistics
+import subprocess
+import sys
+import time
+
+import httpbench
+
+
+def generate(path, commits, files, seed):
+    subprocess.check_call(["git", "init", "-q", path])
+    subprocess.check_call(["git", "-C", path, "symbolic-ref", "HEAD", "refs/heads/master"])
+    names = ["src/d%02d/file%05d.c" % (f % 50, f) for f in range(files)]
+    hot = max(1, files // 100)
+    rnd = random.Random(seed)
+    fast_import = subprocess.Popen(["git", "-C", path, "fast-import", "--quiet"], stdin=subprocess.PIPE)
+    out = []
+    for i in range(commits):
+        if i == 0:
+            touched = range(files)
+        else:
+            touched = set()
+            for _ in range(rnd.randint(1, 3)):
+                touched.add(rnd.randrange(hot) if rnd.random() < 0.5 else rnd.randrange(files))
+        message = "commit %d\n" % i
+        out.append("commit refs/heads/master\nmark :%d\ncommitter Bench <bench@example.com> %d +0000\n"
+                   "data %d\n%s" % (i + 1, 1600000000 + i, len(message), message))
+        if i > 0:
+            out.append("from :%d\n" % i)
+        for f in touched:
+            content = "%s %d\n" % (names[f], i)
+            out.append("M 100644 inline %s\ndata %d\n%s\n" % (names[f], len(content), content))
+        if len(out) > 10000:
+            fast_import.stdin.write("".join(out).encode())
+            out = []
+    fast_import.stdin.write("".join(out).encode())
+    fast_import.stdin.close()
+    if fast_import.wait() != 0:
+        sys.exit("git fast-import failed")
+    return names, hot
+
+
+def wait_for_index(port, commits, timeout):
+    end = time.monotonic() + timeout
+    while time.monotonic() < end:
+        _, body = httpbench.get(port, "/cache/v2")
+        match = re.search(r"^history\s+commits (\d+) .* (ready|updating)$", body.decode(), re.M)
+        if match and int(match.group(1)) >= commits and match.group(2) == "ready":
+            return
+        time.sleep(0.5)
+    sys.exit("history index not ready after %d s" % timeout)
+
+
+def measure(port, paths):
+    times = []
+    for path in paths:
+        elapsed, body = httpbench.timed_get(port, path)
+        if not body:
+            sys.exit(path + ": empty history")
+        times.append(elapsed)
+    return times
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--server", required=True, help="rest4git binary")
+    parser.add_argument("--dir", required=True, help="synthetic repository, generated unless it exists")
+    parser.add_argument("--port", type=int, default=8090)
+    parser.add_argument("--commits", type=int, default=100000)
+    parser.add_argument("--files", type=int, default=5000)
+    parser.add_argument("--sample", type=int, default=10, help="hot and cold files measured each")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--timeout", type=int, default=1800, help="seconds to wait for the index")
+    args = parser.parse_args()
+
+    if not os.path.isdir(args.dir):
+        start = time.monotonic()
+        names, hot = generate(args.dir, args.commits, args.files, args.seed)
+        print("generated %d commits, %d files in %.1f s" % (args.commits, args.files, time.monotonic() - start))
+    else:
+        names = ["src/d%02d/file%05d.c" % (f % 50, f) for f in range(args.files)]
+        hot = max(1, args.files // 100)
+    # The index is built from scratch, so its build time is measured too.
+    index_file = os.path.join(args.dir, ".git", "rest4git-history")
+    if os.path.exists(index_file):
+        os.remove(index_file)
+
+    rnd = random.Random(args.seed)
+    files = {
+        "hot": rnd.sample(names[:hot], min(args.sample, hot)),
+        "cold": rnd.sample(names[hot:], min(args.sample, len(names) - hot)),
+    }
+    queries = [("last 10", "/commit/oneline/v2/10/"), ("all", "/commit/oneline/v2/0/")]
+
+    results = {}
+    for mode in ("walk", "index"):
+        env = {"REST4GIT_HISTORY": "0"} if mode == "walk" else {}
+        start = time.monotonic()
+        with httpbench.Server(args.server, args.dir, args.port, env=env) as server:
+            if mode == "index":
+                wait_for_index(server.port, args.commits, args.timeout)
+                print("index built in %.1f s" % (time.monotonic() - start))
+            for kind, sample in files.items():
+                for label, prefix in queries:
+                    results[(mode, kind, label)] = measure(server.port, [prefix + f for f in sample])
+
+    print("\n%-14s %14s %14s %9s" % ("history", "walk ms", "index ms", "speedup"))
+    for kind in files:
+        for label, _ in queries:
+            walk = statistics.median(results[("walk", kind, label)]) * 1e3
+            index = statistics.median(results[("index", kind, label)]) * 1e3
+            print("%-14s %14.2f %14.2f %8.0fx" % (kind + " " + label, walk, index, walk / index))
+
+
+if __name__ == "__main__":
+    main()
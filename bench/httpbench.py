@@ -0,0 +1,211 @@
+"""Helpers shared by the rest4git benchmarks.
+
+Starts a rest4git server, talks HTTP/1.1 to it over raw TCP or Unix
+domain sockets and runs client processes that report per-request
+latencies.
+"""
+
+import multiprocessing
+import os
+import socket
+import subprocess
+import sys
+import time
+
+
+class Server:
+    """rest4git serving repo on port, stopped when the with block ends."""
+
+    def __init__(self, binary, repo, port, args=(), env=None, unix_socket=None, timeout=60):
+        self.port = port
+        self.unix_socket = unix_socket
+        command = [binary, "--repo", repo, "--port", str(port)] + list(args)
+        if unix_socket:
+            command += ["--unix-socket", unix_socket]
+        environ = dict(os.environ)
+        environ.update(env or {})
+        self.process = subprocess.Popen(command, env=environ,
+                                        stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        end = time.monotonic() + timeout
+        while True:
+            try:
+                status, _ = get(port, "/branch/v2/current")
+                if status == 200:
+                    break
+            except OSError:
+                pass
+            if self.process.poll() is not None or time.monotonic() > end:
+                self.stop()
+                sys.exit("server did not start: " + " ".join(command))
+            time.sleep(0.2)
+
+    def stop(self):
+        if self.process.poll() is None:
+            self.process.terminate()
+        self.process.wait()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.stop()
+
+
+def connect(port, unix_socket=None):
+    if unix_socket:
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        sock.connect(unix_socket)
+    else:
+        sock = socket.create_connection(("127.0.0.1", port))
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+    return sock
+
+
+def request_bytes(path, close, method="GET", body=b""):
+    head = "%s %s HTTP/1.1\r\nHost: localhost\r\nUser-Agent: Wget/1.21.2\r\nAccept-Encoding: identity\r\n" % (method, path)
+    if close:
+        head += "Connection: close\r\n"
+    if body:
+        head += "Content-Length: %d\r\n" % len(body)
+    return (head + "\r\n").encode() + body
+
+
+def read_response(sock, close):
+    """Status and body of one response, the time of its first byte."""
+    data = b""
+    first = None
+    while b"\r\n\r\n" not in data:
+        chunk = sock.recv(65536)
+        if not chunk:
+            raise OSError("connection closed in the headers")
+        first = first or time.perf_counter()
+        data += chunk
+    head, _, body = data.partition(b"\r\n\r\n")
+    lines = head.decode("latin-1").split("\r\n")
+    status = int(lines[0].split()[1])
+    headers = {}
+    for line in lines[1:]:
+        name, _, value = line.partition(":")
+        headers[name.strip().lower()] = value.strip()
+
+    if "content-length" in headers:
+        length = int(headers["content-length"])
+        while len(body) < length:
+            chunk = sock.recv(65536)
+            if not chunk:
+                raise OSError("connection closed in the body")
+            body += chunk
+    elif headers.get("transfer-encoding") == "chunked":
+        while not body.endswith(b"0\r\n\r\n"):
+            chunk = sock.recv(65536)
+            if not chunk:
+                raise OSError("connection closed in the body")
+            body += chunk
+        body = dechunk(body)
+    elif close:
+        while True:
+            chunk = sock.recv(65536)
+            if not chunk:
+                break
+            body += chunk
+    return status, body, first
+
+
+def dechunk(data):
+    out = b""
+    while True:
+        size, _, data = data.partition(b"\r\n")
+        size = int(size, 16)
+        if size == 0:
+            return out
+        out += data[:size]
+        data = data[size + 2:]
+
+
+def get(port, path, unix_socket=None, method="GET", body=b""):
+    """One request on a connection of its own, returns status and body."""
+    sock = connect(port, unix_socket)
+    try:
+        sock.sendall(request_bytes(path, True, method, body))
+        status, body, _ = read_response(sock, True)
+        return status, body
+    finally:
+        sock.close()
+
+
+def timed_get(port, path, unix_socket=None):
+    """Seconds a request on a connection of its own takes, and its body."""
+    start = time.perf_counter()
+    status, body = get(port, path, unix_socket)
+    elapsed = time.perf_counter() - start
+    if status != 200:
+        sys.exit("%s: HTTP %d" % (path, status))
+    return elapsed, body
+
+
+def client(port, unix_socket, paths, seconds, keepalive, index, results):
+    """Requests paths in turn for seconds. Records the time from connecting,
+    or sending on a kept connection, to the first byte of the response."""
+    latencies = []
+    sock = None
+    end = time.monotonic() + seconds
+    i = index
+    while time.monotonic() < end:
+        path = paths[i % len(paths)]
+        i += 1
+        start = time.perf_counter()
+        if sock is None:
+            sock = connect(port, unix_socket)
+        sock.sendall(request_bytes(path, not keepalive))
+        status, _, first = read_response(sock, not keepalive)
+        if status != 200:
+            sys.exit("%s: HTTP %d" % (path, status))
+        latencies.append(first - start)
+        if not keepalive:
+            sock.close()
+            sock = None
+    if sock is not None:
+        sock.close()
+    results.put(latencies)
+
+
+def run_clients(port, paths, clients, seconds, keepalive, unix_socket=None):
+    """Requests per second and sorted latencies of clients processes."""
+    results = multiprocessing.Queue()
+    procs = [multiprocessing.Process(target=client,
+                                     args=(port, unix_socket, paths, seconds, keepalive, i, results))
+             for i in range(clients)]
+    start = time.monotonic()
+    for p in procs:
+        p.start()
+    latencies = []
+    for _ in procs:
+        latencies += results.get()
+    for p in procs:
+        p.join()
+    elapsed = time.monotonic() - start
+    return len(latencies) / elapsed, sorted(latencies)
+
+
+def percentile(values, p):
+    if not values:
+        return 0.0
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+def report(label, rate, latencies):
+    print("%-28s %8.0f req/s   p50 %8.1f us   p99 %8.1f us"
+          % (label, rate, percentile(latencies, 50) * 1e6, percentile(latencies, 99) * 1e6))
+    sys.stdout.flush()
+
+
+def repo_files(repo, count=None):
+    files = subprocess.check_output(["git", "-C", repo, "ls-files"], text=True).split("\n")
+    files = [f for f in files if f]
+    if not files:
+        files = subprocess.check_output(["git", "-C", repo, "ls-tree", "-r", "--name-only", "HEAD"],
+                                        text=True).split("\n")
+        files = [f for f in files if f]
+    if not files:
+        sys.exit("no files in " + repo)
+    return files[:count] if count else files
@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+"""Blame throughput of rest4git at 1, 2, 4, 8 and 16 threads.
+
+Starts the server once per thread count with as many io threads and git
+workers, lets as many client processes request /blame/v2 of the first
+files of the repository over keep-alive connections and prints the
+requests per second.
+
+  bench/scaling.py --server build/src/rest4git --repo /path/to/repo
+"""
+
+import argparse
+import http.client
+import multiprocessing
+import os
+import subprocess
+import sys
+import time
+
+
+def client(port, paths, seconds, counts, index):
+    conn = http.client.HTTPConnection("127.0.0.1", port)
+    done = 0
+    end = time.monotonic() + seconds
+    i = index
+    while time.monotonic() < end:
+        conn.request("GET", paths[i % len(paths)])
+        response = conn.getresponse()
+        response.read()
+        if response.status != 200:
+            sys.exit("%s: HTTP %d" % (paths[i % len(paths)], response.status))
+        done += 1
+        i += 1
+    counts[index] = done
+
+
+def wait_ready(port, timeout=30):
+    end = time.monotonic() + timeout
+    while time.monotonic() < end:
+        try:
+            conn = http.client.HTTPConnection("127.0.0.1", port, timeout=1)
+            conn.request("GET", "/branch/v2")
+            conn.getresponse().read()
+            return
+        except OSError:
+            time.sleep(0.2)
+    sys.exit("server did not start")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--server", required=True, help="rest4git binary")
+    parser.add_argument("--repo", required=True, help="repository to serve")
+    parser.add_argument("--port", type=int, default=8090)
+    parser.add_argument("--files", type=int, default=200, help="files blamed in turn")
+    parser.add_argument("--seconds", type=float, default=10)
+    parser.add_argument("--threads", default="1,2,4,8,16")
+    parser.add_argument("--cold", action="store_true", help="measure with empty caches")
+    args = parser.parse_args()
+
+    files = subprocess.check_output(["git", "-C", args.repo, "ls-files"], text=True).split("\n")
+    paths = ["/blame/v2/" + f for f in files if f][:args.files]
+    if not paths:
+        sys.exit("no files in " + args.repo)
+
+    print("threads  req/s")
+    for threads in (int(t) for t in args.threads.split(",")):
+        server = subprocess.Popen([args.server, "--repo", args.repo, "--port", str(args.port),
+                                   "--io-threads", str(threads), "--git-workers", str(threads)],
+                                  stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+        try:
+            wait_ready(args.port)
+            if not args.cold:
+                # Fills the caches, the run measures the steady state.
+                warm = http.client.HTTPConnection("127.0.0.1", args.port)
+                for path in paths:
+                    warm.request("GET", path)
+                    warm.getresponse().read()
+            counts = multiprocessing.Manager().dict()
+            procs = [multiprocessing.Process(target=client, args=(args.port, paths, args.seconds, counts, i))
+                     for i in range(threads)]
+            start = time.monotonic()
+            for p in procs:
+                p.start()
+            for p in procs:
+                p.join()
+            elapsed = time.monotonic() - start
+            print("%7d  %5.0f" % (threads, sum(counts.values()) / elapsed))
+        finally:
+            server.terminate()
+            server.wait()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,47 @@
+#!/usr/bin/env python3
+"""Latency of small /blame/v2 responses over loopback TCP and a Unix socket.
+
+Starts one server listening on --port and on a Unix domain socket and
+lets client processes blame a few lines of the first files of the
+repository through either, once with a connection per request, like
+wget, and once over kept-alive connections.
+
+  bench/uds.py --server build/src/rest4git --repo /path/to/repo
+"""
+
+import argparse
+import os
+import tempfile
+
+import httpbench
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--server", required=True, help="rest4git binary")
+    parser.add_argument("--repo", required=True, help="repository to serve")
+    parser.add_argument("--port", type=int, default=8090)
+    parser.add_argument("--files", type=int, default=50, help="files blamed in turn")
+    parser.add_argument("--clients", type=int, default=1)
+    parser.add_argument("--seconds", type=float, default=10)
+    parser.add_argument("--rounds", type=int, default=3)
+    args = parser.parse_args()
+
+    paths = ["/blame/v2/1/3/" + f for f in httpbench.repo_files(args.repo, args.files)]
+    unix_socket = os.path.join(tempfile.mkdtemp(), "rest4git.sock")
+    with httpbench.Server(args.server, args.repo, args.port, unix_socket=unix_socket) as server:
+        # Fills the blame cache, the runs measure the transport.
+        for path in paths:
+            httpbench.timed_get(server.port, path)
+        for keepalive in (False, True):
+            print("%d clients, %s" % (args.clients, "kept-alive connections" if keepalive else "connection per request"))
+            for _ in range(args.rounds):
+                for label, socket_path in (("TCP", None), ("UDS", unix_socket)):
+                    rate, latencies = httpbench.run_clients(server.port, paths, args.clients, args.seconds,
+                                                            keepalive, socket_path)
+                    httpbench.report("  " + label, rate, latencies)
+    os.rmdir(os.path.dirname(unix_socket))
+
+
+if __name__ == "__main__":
+    main()
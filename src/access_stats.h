@@ -0,0 +1,101 @@
+/// \file access_stats.h
+/// \brief Per-path request counters for rest4git.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// Counts how often every file is requested, so background jobs know the
+/// hot files. Paths are spread over locked shards like the LRU caches. A
+/// shard that tracks too many paths halves its counters and forgets the
+/// paths reaching zero, so old popularity fades out.
+
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "singleton.h"
+
+namespace rest4git
+{
+
+class AccessStats : public Notcopyable
+{
+public:
+  explicit AccessStats(size_t max_paths, size_t shards = 16)
+    : m_shards(shards == 0 ? 1 : shards)
+  {
+    for (auto& shard : m_shards)
+    {
+      shard.max_paths = std::max<size_t>(1, max_paths / m_shards.size());
+    }
+  }
+
+  void record(const std::string& path)
+  {
+    Shard& shard = m_shards[std::hash<std::string>()(path) % m_shards.size()];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.counts[path]++;
+    if (shard.counts.size() > shard.max_paths)
+    {
+      for (auto it = shard.counts.begin(); it != shard.counts.end();)
+      {
+        it->second /= 2;
+        it = (it->second == 0) ? shard.counts.erase(it) : std::next(it);
+      }
+    }
+  }
+
+  /// The \p n most requested paths, most requested first.
+  void top(size_t n, std::vector<std::string>& paths) const
+  {
+    std::vector<std::pair<uint64_t, std::string>> all;
+    for (const auto& shard : m_shards)
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      for (const auto& count : shard.counts)
+      {
+        all.push_back(std::make_pair(count.second, count.first));
+      }
+    }
+
+    n = std::min(n, all.size());
+    std::partial_sort(all.begin(), all.begin() + n, all.end(),
+      [](const std::pair<uint64_t, std::string>& a, const std::pair<uint64_t, std::string>& b)
+      { return a.first > b.first || (a.first == b.first && a.second < b.second); });
+    paths.clear();
+    for (size_t i = 0; i < n; ++i)
+    {
+      paths.push_back(std::move(all[i].second));
+    }
+  }
+
+  size_t size() const
+  {
+    size_t n = 0;
+    for (const auto& shard : m_shards)
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      n += shard.counts.size();
+    }
+    return n;
+  }
+
+private:
+  struct Shard
+  {
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, uint64_t> counts;
+    size_t max_paths;
+  };
+
+  std::vector<Shard> m_shards;
+};
+
+} // rest4git
@@ -0,0 +1,86 @@
+/// \file blame_result.h
+/// \brief Cacheable whole-file blame for rest4git.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// A git_blame copied into plain data so it can outlive the repository
+/// handle it was computed with and be shared between worker threads.
+
+#pragma once
+#ifdef LIBGIT2_AVAILABLE
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <git2.h>
+
+namespace rest4git
+{
+
+struct BlameHunk
+{
+  uint32_t start;         ///< First line of the hunk in the blamed blob, 1-based
+  uint32_t lines;
+  git_oid commit;         ///< Commit that last changed these lines
+  git_time_t time;
+  std::string email;
+};
+
+struct BlameResult
+{
+  git_oid head;           ///< Commit the blame was computed at
+  git_oid blob;           ///< Blob of the blamed file at head
+  std::vector<BlameHunk> hunks;
+
+  /// Appends lines in order, extending the last hunk if it is the same commit.
+  void append(uint32_t start, uint32_t lines, const git_oid& commit, git_time_t time, const std::string& email)
+  {
+    if (!hunks.empty())
+    {
+      BlameHunk& last = hunks.back();
+      if (last.start + last.lines == start && git_oid_equal(&last.commit, &commit))
+      {
+        last.lines += lines;
+        return;
+      }
+    }
+    BlameHunk h;
+    h.start = start;
+    h.lines = lines;
+    h.commit = commit;
+    h.time = time;
+    h.email = email;
+    hunks.push_back(std::move(h));
+  }
+
+  const BlameHunk* hunk_byline(uint32_t line) const
+  {
+    auto it = std::upper_bound(hunks.begin(), hunks.end(), line,
+      [](uint32_t l, const BlameHunk& h) { return l < h.start; });
+    if (it == hunks.begin())
+    {
+      return nullptr;
+    }
+    --it;
+    return (line < it->start + it->lines) ? &(*it) : nullptr;
+  }
+
+  /// Approximate memory footprint, used as the cache weight.
+  size_t weight() const
+  {
+    size_t w = sizeof(BlameResult) + hunks.capacity() * sizeof(BlameHunk);
+    for (const auto& h : hunks)
+    {
+      w += h.email.capacity();
+    }
+    return w;
+  }
+};
+
+typedef std::shared_ptr<const BlameResult> BlameResultPtr;
+
+} // rest4git
+
+#endif // LIBGIT2_AVAILABLE
@@ -0,0 +1,189 @@
+/// \file blame_warmup.cpp
+/// \brief Implementation for rest4git::BlameWarmup.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// Implementation for the throttled blame warmup job
+///
+
+#ifdef LIBGIT2_AVAILABLE
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "blame_warmup.h"
+#include "server_config.h"
+#include "crow/crow_all.h"
+
+namespace rest4git
+{
+
+BlameWarmup::BlameWarmup()
+  : m_access(WARMUP_TRACKED_PATHS)
+  , m_files_max(0)
+  , m_duty(1.0)
+  , m_stop(false)
+  , m_check(false)
+  , m_checking(false)
+  , m_has_head(false)
+  , m_next(0)
+  , m_done(0)
+  , m_rounds(0)
+  , m_warmed(0)
+{
+}
+
+BlameWarmup::~BlameWarmup()
+{
+  stop();
+}
+
+bool BlameWarmup::start(HeadFn head, WarmFn warm, size_t files, unsigned int cpu_percent)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_threads.empty() || files == 0 || cpu_percent == 0)
+  {
+    return false;
+  }
+
+  // E.g. 25% of 8 cores are two threads always working, 25% of one core
+  // is one thread idling three times as long as it worked.
+  const double cores = available_cpus() * std::min(cpu_percent, 100u) / 100.0;
+  const size_t threads = static_cast<size_t>(std::ceil(cores));
+  m_duty = cores / threads;
+  m_head_fn = head;
+  m_warm_fn = warm;
+  m_files_max = files;
+  m_stop = false;
+  m_check = true;
+  for (size_t i = 0; i < threads; ++i)
+  {
+    m_threads.emplace_back([this] { run(); });
+  }
+  CROW_LOG_INFO << "blame warmup: " << files << " files, " << threads << " threads, duty " << m_duty;
+  return true;
+}
+
+void BlameWarmup::stop()
+{
+  std::vector<std::thread> threads;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+    threads.swap(m_threads);
+  }
+  m_cv.notify_all();
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+}
+
+void BlameWarmup::record(const std::string& path)
+{
+  m_access.record(path);
+}
+
+void BlameWarmup::request()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_check = true;
+  }
+  m_cv.notify_one();
+}
+
+void BlameWarmup::print_stats(std::stringstream& ss) const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  char head[12] = {0};
+  if (m_has_head)
+  {
+    git_oid_tostr(head, sizeof(head), &m_head);
+  }
+  ss << std::left << std::setw(12) << "warmup"
+     << " rounds " << m_rounds
+     << " head " << (m_has_head ? head : "none")
+     << " done " << m_done << "/" << m_files.size()
+     << " warmed " << m_warmed
+     << " tracked " << m_access.size()
+     << (m_threads.empty() ? " disabled" : (m_next < m_files.size() ? " warming" : " idle")) << std::endl;
+}
+
+void BlameWarmup::run()
+{
+  // Lowest priority, requests always win the cores.
+  setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), WARMUP_NICE);
+  limit_openmp();
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  while (!m_stop)
+  {
+    if (!m_checking && (m_check ||
+        std::chrono::steady_clock::now() - m_checked >= std::chrono::milliseconds(WARMUP_POLL_MS)))
+    {
+      check_head(lock);
+      continue;
+    }
+    if (m_next >= m_files.size())
+    {
+      m_cv.wait_for(lock, std::chrono::milliseconds(WARMUP_POLL_MS));
+      continue;
+    }
+
+    const std::string file = m_files[m_next++];
+    const git_oid head = m_head;
+    const uint64_t round = m_rounds;
+    lock.unlock();
+    const auto started = std::chrono::steady_clock::now();
+    m_warm_fn(head, file);
+    const auto spent = std::chrono::steady_clock::now() - started;
+    m_warmed++;
+    lock.lock();
+    if (round == m_rounds)
+    {
+      m_done++;
+    }
+
+    // Idle so that the time spent working stays at the duty share.
+    if (m_duty < 1.0)
+    {
+      m_cv.wait_for(lock, std::chrono::duration_cast<std::chrono::microseconds>(spent * ((1.0 - m_duty) / m_duty)),
+        [this] { return m_stop; });
+    }
+  }
+}
+
+void BlameWarmup::check_head(std::unique_lock<std::mutex>& lock)
+{
+  m_checking = true;
+  m_check = false;
+  lock.unlock();
+  git_oid head;
+  const bool found = m_head_fn(head);
+  lock.lock();
+  m_checking = false;
+  m_checked = std::chrono::steady_clock::now();
+  if (!found || (m_has_head && git_oid_equal(&head, &m_head)))
+  {
+    return;
+  }
+
+  // A round still running for the old HEAD is abandoned.
+  m_head = head;
+  m_has_head = true;
+  m_access.top(m_files_max, m_files);
+  m_next = 0;
+  m_done = 0;
+  m_rounds++;
+  CROW_LOG_INFO << "blame warmup: round " << m_rounds << ", " << m_files.size() << " files";
+  m_cv.notify_all();
+}
+
+} // rest4git
+
+#endif // LIBGIT2_AVAILABLE
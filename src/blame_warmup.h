@@ -0,0 +1,91 @@
+/// \file blame_warmup.h
+/// \brief Background blame warmup of the hot files after HEAD moved.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// Without it the first client blaming a hot file after a HEAD move pays
+/// the whole cold cost. The job notices a new HEAD by polling or by
+/// request(), takes the most requested files from the access statistics
+/// and lets a few niced threads recompute their blames and line indexes.
+/// Each thread idles between files, so the job uses at most the
+/// configured share of the cores.
+
+#pragma once
+#ifdef LIBGIT2_AVAILABLE
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <git2.h>
+#include "singleton.h"
+#include "access_stats.h"
+
+namespace rest4git
+{
+
+/// Paths counted before the counters are halved.
+const size_t WARMUP_TRACKED_PATHS = 64 * 1024;
+const size_t WARMUP_FILES = 100;
+/// Share of all cores in percent.
+const unsigned int WARMUP_CPU_PERCENT = 25;
+const uint32_t WARMUP_POLL_MS = 2000;
+const int WARMUP_NICE = 19;
+
+class BlameWarmup : public Notcopyable
+{
+public:
+  /// Resolves HEAD, false if there is none.
+  typedef std::function<bool(git_oid&)> HeadFn;
+  /// Computes and caches everything needed to serve \p file at \p head.
+  typedef std::function<void(const git_oid& head, const std::string& file)> WarmFn;
+public:
+  explicit BlameWarmup();
+  virtual ~BlameWarmup();
+public:
+  /// \param files Files warmed per HEAD, 0 disables the job.
+  /// \param cpu_percent Share of all cores the job may use.
+  bool start(HeadFn head, WarmFn warm, size_t files = WARMUP_FILES,
+             unsigned int cpu_percent = WARMUP_CPU_PERCENT);
+  void stop();
+  /// Counts a request for \p path.
+  void record(const std::string& path);
+  /// HEAD may have moved, checks at once instead of at the next poll.
+  void request();
+  void print_stats(std::stringstream& ss) const;
+private:
+  void run();
+  /// Starts a new round if HEAD moved, called with m_mutex held.
+  void check_head(std::unique_lock<std::mutex>& lock);
+private:
+  AccessStats m_access;
+  HeadFn m_head_fn;
+  WarmFn m_warm_fn;
+  size_t m_files_max;
+  double m_duty;
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::vector<std::thread> m_threads;
+  bool m_stop;
+  bool m_check;
+  bool m_checking;
+  std::chrono::steady_clock::time_point m_checked;
+  /// Current round: HEAD, its files and the next one to take.
+  git_oid m_head;
+  bool m_has_head;
+  std::vector<std::string> m_files;
+  size_t m_next;
+  size_t m_done;
+  uint64_t m_rounds;
+  std::atomic<uint64_t> m_warmed;
+};
+
+} // rest4git
+
+#endif // LIBGIT2_AVAILABLE
@@ -0,0 +1,124 @@
+/// \file blob_lines.h
+/// \brief Blob content with a newline offset index for rest4git.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// Line range requests jump straight to the offsets of the requested
+/// lines instead of scanning the blob from its first byte. The index is
+/// built once per blob with a vectorized newline scan and cached by oid
+/// together with a copy of the content.
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace rest4git
+{
+
+class BlobLines
+{
+public:
+  static std::shared_ptr<const BlobLines> build(const char* data, size_t size)
+  {
+    if (size >= std::numeric_limits<uint32_t>::max())
+    {
+      return nullptr;
+    }
+
+    std::shared_ptr<BlobLines> blob = std::make_shared<BlobLines>();
+    blob->m_data.assign(data, size);
+    blob->m_starts.reserve(size / 32 + 2);
+    blob->m_starts.push_back(0);
+    scan_newlines(blob->m_data.data(), size, blob->m_starts);
+    if (blob->m_starts.back() != size)
+    {
+      // Last line without trailing newline
+      blob->m_starts.push_back(static_cast<uint32_t>(size + 1));
+    }
+    blob->m_starts.shrink_to_fit();
+    return blob;
+  }
+
+  const std::string& data() const
+  {
+    return m_data;
+  }
+
+  uint32_t lines() const
+  {
+    return static_cast<uint32_t>(m_starts.size() - 1);
+  }
+
+  /// Text of line \p line (1-based) without its newline.
+  bool line(uint32_t line, const char*& text, size_t& len) const
+  {
+    if (line == 0 || line > lines())
+    {
+      return false;
+    }
+    text = m_data.data() + m_starts[line - 1];
+    len = m_starts[line] - m_starts[line - 1] - 1;
+    return true;
+  }
+
+  size_t weight() const
+  {
+    return sizeof(BlobLines) + m_data.capacity() + m_starts.capacity() * sizeof(uint32_t);
+  }
+
+  /// Appends the offset following every '\n' in data to starts.
+  static void scan_newlines(const char* data, size_t size, std::vector<uint32_t>& starts)
+  {
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i nl = _mm256_set1_epi8('\n');
+    for (; i + 32 <= size; i += 32)
+    {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+      uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl)));
+      while (mask)
+      {
+        starts.push_back(static_cast<uint32_t>(i + __builtin_ctz(mask) + 1));
+        mask &= mask - 1;
+      }
+    }
+#elif defined(__SSE2__)
+    const __m128i nl = _mm_set1_epi8('\n');
+    for (; i + 16 <= size; i += 16)
+    {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+      uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)));
+      while (mask)
+      {
+        starts.push_back(static_cast<uint32_t>(i + __builtin_ctz(mask) + 1));
+        mask &= mask - 1;
+      }
+    }
+#endif
+    for (; i < size; ++i)
+    {
+      if (data[i] == '\n')
+      {
+        starts.push_back(static_cast<uint32_t>(i + 1));
+      }
+    }
+  }
+
+private:
+  std::string m_data;
+  /// Offset of the first byte of every line, then one past the last newline.
+  std::vector<uint32_t> m_starts;
+};
+
+typedef std::shared_ptr<const BlobLines> BlobLinesPtr;
+
+} // rest4git
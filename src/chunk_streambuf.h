@@ -0,0 +1,81 @@
+/// \file chunk_streambuf.h
+/// \brief std::streambuf feeding a streamed response for rest4git.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// Lets the Git2API functions writing into a std::ostream produce a
+/// chunked response. Output is collected into chunks of STREAM_CHUNK_SIZE
+/// bytes, std::endl does not send the partial chunk, finish() does. Once
+/// the client is gone writes fail, so the ostream goes bad.
+
+#pragma once
+#include <memory>
+#include <streambuf>
+#include <string>
+
+#include "crow/crow_all.h"
+
+namespace rest4git
+{
+
+const size_t STREAM_CHUNK_SIZE = 64 * 1024;
+/// Bytes queued for a client before the producer waits for it.
+const size_t STREAM_QUEUE_SIZE = 4 * STREAM_CHUNK_SIZE;
+
+class ChunkStreamBuf : public std::streambuf
+{
+public:
+  explicit ChunkStreamBuf(std::shared_ptr<crow::body_stream> stream)
+    : m_stream(stream)
+    , m_buffer(STREAM_CHUNK_SIZE, '\0')
+    , m_failed(false)
+  {
+    setp(&m_buffer[0], &m_buffer[0] + m_buffer.size());
+  }
+
+  /// Sends the rest, false if the client is gone.
+  bool finish()
+  {
+    return send();
+  }
+
+protected:
+  int_type overflow(int_type c) override
+  {
+    if (!send())
+    {
+      return traits_type::eof();
+    }
+    if (!traits_type::eq_int_type(c, traits_type::eof()))
+    {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+  int sync() override
+  {
+    return m_failed ? -1 : 0;
+  }
+
+private:
+  bool send()
+  {
+    const std::ptrdiff_t size = pptr() - pbase();
+    if (!m_failed && size > 0 && !m_stream->write(std::string(pbase(), size)))
+    {
+      m_failed = true;
+    }
+    setp(&m_buffer[0], &m_buffer[0] + m_buffer.size());
+    return !m_failed;
+  }
+
+private:
+  std::shared_ptr<crow::body_stream> m_stream;
+  std::string m_buffer;
+  bool m_failed;
+};
+
+} // rest4git
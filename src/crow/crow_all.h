@@ -1,36 +1,163 @@
 #pragma once
 
-#include <boost/algorithm/string/predicate.hpp>
-#include <boost/functional/hash.hpp>
+#include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace crow
 {
-    struct ci_hash
+    struct ci_key_eq
     {
-        size_t operator()(const std::string& key) const
+        bool operator()(const std::string& l, const std::string& r) const
         {
-            std::size_t seed = 0;
-            std::locale locale;
-
-            for(auto c : key)
+            if (l.size() != r.size())
+                return false;
+            for(size_t i = 0; i < l.size(); i ++)
             {
-                boost::hash_combine(seed, std::toupper(c, locale));
+                char a = l[i], b = r[i];
+                if (a >= 'A' && a <= 'Z')
+                    a += 'a' - 'A';
+                if (b >= 'A' && b <= 'Z')
+                    b += 'a' - 'A';
+                if (a != b)
+                    return false;
             }
-
-            return seed;
+            return true;
         }
     };
 
-    struct ci_key_eq
+    // Header fields in the order they were added, with case insensitive
+    // lookup. A message has a dozen of them, so a linear search beats
+    // hashing. clear() keeps the strings, a map reused for the next message
+    // of a connection refills them without allocating.
+    class ci_map
     {
-        bool operator()(const std::string& l, const std::string& r) const
+    public:
+        using value_type = std::pair<std::string, std::string>;
+        using iterator = std::vector<value_type>::iterator;
+        using const_iterator = std::vector<value_type>::const_iterator;
+
+        ci_map() {}
+
+        ci_map(const ci_map& other)
+            : items_(other.begin(), other.end()), size_(other.size_)
         {
-            return boost::iequals(l, r);
         }
-    };
 
-    using ci_map = std::unordered_multimap<std::string, std::string, ci_hash, ci_key_eq>;
+        ci_map(ci_map&& other) noexcept
+        {
+            swap(other);
+        }
+
+        ci_map& operator = (const ci_map& other)
+        {
+            if (this == &other)
+                return *this;
+            clear();
+            for(auto& kv : other)
+            {
+                auto& item = add();
+                item.first.assign(kv.first);
+                item.second.assign(kv.second);
+            }
+            return *this;
+        }
+
+        ci_map& operator = (ci_map&& other) noexcept
+        {
+            swap(other);
+            return *this;
+        }
+
+        void swap(ci_map& other) noexcept
+        {
+            items_.swap(other.items_);
+            std::swap(size_, other.size_);
+        }
+
+        iterator begin() { return items_.begin(); }
+        iterator end() { return items_.begin() + size_; }
+        const_iterator begin() const { return items_.begin(); }
+        const_iterator end() const { return items_.begin() + size_; }
+
+        size_t size() const { return size_; }
+        bool empty() const { return size_ == 0; }
+
+        void clear()
+        {
+            size_ = 0;
+        }
+
+        // Appends an empty field to be filled in place.
+        value_type& add()
+        {
+            if (size_ == items_.size())
+                items_.emplace_back();
+            auto& item = items_[size_++];
+            item.first.clear();
+            item.second.clear();
+            return item;
+        }
+
+        iterator emplace(std::string key, std::string value)
+        {
+            auto& item = add();
+            item.first.swap(key);
+            item.second.swap(value);
+            return end() - 1;
+        }
+
+        iterator find(const std::string& key)
+        {
+            ci_key_eq eq;
+            for(auto it = begin(); it != end(); ++it)
+                if (eq(it->first, key))
+                    return it;
+            return end();
+        }
+
+        const_iterator find(const std::string& key) const
+        {
+            ci_key_eq eq;
+            for(auto it = begin(); it != end(); ++it)
+                if (eq(it->first, key))
+                    return it;
+            return end();
+        }
+
+        size_t count(const std::string& key) const
+        {
+            ci_key_eq eq;
+            size_t n = 0;
+            for(auto& kv : *this)
+                if (eq(kv.first, key))
+                    n ++;
+            return n;
+        }
+
+        // Removes every field named key, the others keep their order.
+        size_t erase(const std::string& key)
+        {
+            ci_key_eq eq;
+            size_t kept = 0;
+            for(size_t i = 0; i < size_; i ++)
+            {
+                if (eq(items_[i].first, key))
+                    continue;
+                if (i != kept)
+                    items_[i].swap(items_[kept]);
+                kept ++;
+            }
+            size_t erased = size_ - kept;
+            size_ = kept;
+            return erased;
+        }
+
+    private:
+        std::vector<value_type> items_;
+        size_t size_{};
+    };
 }
 
 
@@ -578,6 +705,37 @@ namespace crow
             key_value_pairs_.resize(count);
         }
 
+        // Parses url into the storage of the previous one.
+        void assign(const std::string& url)
+        {
+            url_.assign(url);
+            key_value_pairs_.clear();
+            if (url_.find_first_of("?#") == std::string::npos)
+                return;
+
+            key_value_pairs_.resize(MAX_KEY_VALUE_PAIRS_COUNT);
+
+            int count = qs_parse(&url_[0], &key_value_pairs_[0], MAX_KEY_VALUE_PAIRS_COUNT);
+            key_value_pairs_.resize(count);
+        }
+
+        void swap(query_string& qs)
+        {
+            const char* old_data = url_.c_str();
+            const char* old_qs_data = qs.url_.c_str();
+            url_.swap(qs.url_);
+            key_value_pairs_.swap(qs.key_value_pairs_);
+            // Short urls live inside the strings, rebase both sides.
+            for(auto& p:key_value_pairs_)
+            {
+                p = (char*)url_.c_str() + (p - old_qs_data);
+            }
+            for(auto& p:qs.key_value_pairs_)
+            {
+                p = (char*)qs.url_.c_str() + (p - old_data);
+            }
+        }
+
         void clear() 
         {
             key_value_pairs_.clear();
@@ -5751,15 +5909,84 @@ namespace crow
             socket_.close(ec);
         }
 
+        // Closes the socket, it accepts the next connection.
+        bool reset()
+        {
+            close();
+            return true;
+        }
+
         template <typename F> 
         void start(F f)
         {
+            // A streamed response is written as head and chunks, Nagle
+            // would hold each back until the client's delayed ACK.
+            boost::system::error_code ec;
+            socket_.set_option(tcp::no_delay(true), ec);
             f(boost::system::error_code());
         }
 
         tcp::socket socket_;
     };
 
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+    // Plain HTTP over a Unix domain socket, for clients on the same host.
+    struct UnixSocketAdaptor
+    {
+        using context = void;
+        using stream_protocol = asio::local::stream_protocol;
+        UnixSocketAdaptor(boost::asio::io_service& io_service, context*)
+            : socket_(io_service)
+        {
+        }
+
+        boost::asio::io_service& get_io_service()
+        {
+            return socket_.get_io_service();
+        }
+
+        stream_protocol::socket& raw_socket()
+        {
+            return socket_;
+        }
+
+        stream_protocol::socket& socket()
+        {
+            return socket_;
+        }
+
+        stream_protocol::endpoint remote_endpoint()
+        {
+            return socket_.remote_endpoint();
+        }
+
+        bool is_open()
+        {
+            return socket_.is_open();
+        }
+
+        void close()
+        {
+            boost::system::error_code ec;
+            socket_.close(ec);
+        }
+
+        bool reset()
+        {
+            close();
+            return true;
+        }
+
+        template <typename F>
+        void start(F f)
+        {
+            f(boost::system::error_code());
+        }
+
+        stream_protocol::socket socket_;
+    };
+#endif
+
 #ifdef CROW_ENABLE_SSL
     struct SSLAdaptor
     {
@@ -5797,6 +6024,12 @@ namespace crow
             raw_socket().close(ec);
         }
 
+        // The stream keeps the state of its TLS session, it is not reused.
+        bool reset()
+        {
+            return false;
+        }
+
         boost::asio::io_service& get_io_service()
         {
             return raw_socket().get_io_service();
@@ -5805,6 +6038,8 @@ namespace crow
         template <typename F> 
         void start(F f)
         {
+            boost::system::error_code ec;
+            raw_socket().set_option(tcp::no_delay(true), ec);
             ssl_socket_->async_handshake(boost::asio::ssl::stream_base::server,
                     [f](const boost::system::error_code& ec) {
                         f(ec);
@@ -6458,7 +6693,29 @@ namespace crow
         std::vector<int64_t> int_params;
         std::vector<uint64_t> uint_params;
         std::vector<double> double_params;
-        std::vector<std::string> string_params;
+        // Offset and length of each string parameter in the url it was
+        // matched in, which outlives the parameters.
+        std::vector<std::pair<size_t, size_t>> string_params;
+        const std::string* url{};
+
+        void clear(const std::string* matched_url = nullptr)
+        {
+            int_params.clear();
+            uint_params.clear();
+            double_params.clear();
+            string_params.clear();
+            url = matched_url;
+        }
+
+        // Copies into the storage already held.
+        void assign(const routing_params& other)
+        {
+            int_params.assign(other.int_params.begin(), other.int_params.end());
+            uint_params.assign(other.uint_params.begin(), other.uint_params.end());
+            double_params.assign(other.double_params.begin(), other.double_params.end());
+            string_params.assign(other.string_params.begin(), other.string_params.end());
+            url = other.url;
+        }
 
         void debug_print() const
         {
@@ -6473,7 +6730,7 @@ namespace crow
                 std::cerr<<i <<", " ;
             std::cerr<<std::endl;
             for(auto& i:string_params)
-                std::cerr<<i <<", " ;
+                std::cerr<<url->substr(i.first, i.second) <<", " ;
             std::cerr<<std::endl;
         }
 
@@ -6503,7 +6760,7 @@ namespace crow
     template<>
     inline std::string routing_params::get<std::string>(unsigned index) const
     {
-        return string_params[index];
+        return url->substr(string_params[index].first, string_params[index].second);
     }
 }
 
@@ -6543,9 +6800,10 @@ namespace crow
     template <typename T>
     inline const std::string& get_header_value(const T& headers, const std::string& key)
     {
-        if (headers.count(key))
+        auto it = headers.find(key);
+        if (it != headers.end())
         {
-            return headers.find(key)->second;
+            return it->second;
         }
         static std::string empty;
         return empty;
@@ -6565,6 +6823,11 @@ namespace crow
         void* middleware_context{};
         boost::asio::io_service* io_service{};
 
+        // Parameters of the matched route and of the route being tried,
+        // kept here so that the next request of the connection reuses them.
+        mutable routing_params route_params;
+        mutable routing_params route_scratch;
+
         request()
             : method(HTTPMethod::Get)
         {
@@ -7168,15 +7431,11 @@ namespace crow
             switch (self->header_building_state)
             {
                 case 0:
-                    if (!self->header_value.empty())
-                    {
-                        self->headers.emplace(std::move(self->header_field), std::move(self->header_value));
-                    }
-                    self->header_field.assign(at, at+length);
+                    self->headers.add().first.assign(at, length);
                     self->header_building_state = 1;
                     break;
                 case 1:
-                    self->header_field.insert(self->header_field.end(), at, at+length);
+                    (self->headers.end() - 1)->first.append(at, length);
                     break;
             }
             return 0;
@@ -7187,11 +7446,11 @@ namespace crow
             switch (self->header_building_state)
             {
                 case 0:
-                    self->header_value.insert(self->header_value.end(), at, at+length);
+                    (self->headers.end() - 1)->second.append(at, length);
                     break;
                 case 1:
                     self->header_building_state = 0;
-                    self->header_value.assign(at, at+length);
+                    (self->headers.end() - 1)->second.assign(at, length);
                     break;
             }
             return 0;
@@ -7199,10 +7458,6 @@ namespace crow
         static int on_headers_complete(http_parser* self_)
         {
             HTTPParser* self = static_cast<HTTPParser*>(self_);
-            if (!self->header_field.empty())
-            {
-                self->headers.emplace(std::move(self->header_field), std::move(self->header_value));
-            }
             self->process_header();
             return 0;
         }
@@ -7217,8 +7472,8 @@ namespace crow
             HTTPParser* self = static_cast<HTTPParser*>(self_);
 
             // url params
-            self->url = self->raw_url.substr(0, self->raw_url.find("?"));
-            self->url_params = query_string(self->raw_url);
+            self->url.assign(self->raw_url, 0, self->raw_url.find("?"));
+            self->url_params.assign(self->raw_url);
 
             self->process_message();
             return 0;
@@ -7252,13 +7507,18 @@ namespace crow
             return feed(nullptr, 0);
         }
 
+        // Forgets a message cut off by the previous client.
+        void reset()
+        {
+            http_parser_init(this, HTTP_REQUEST);
+            clear();
+        }
+
         void clear()
         {
             url.clear();
             raw_url.clear();
             header_building_state = 0;
-            header_field.clear();
-            header_value.clear();
             headers.clear();
             url_params.clear();
             body.clear();
@@ -7274,9 +7534,16 @@ namespace crow
             handler_->handle();
         }
 
-        request to_request() const
+        // Hands the message over by swapping, the parser keeps the buffers
+        // of the previous request to parse the next one into.
+        void to_request(request& req)
         {
-            return request{(HTTPMethod)method, std::move(raw_url), std::move(url), std::move(url_params), std::move(headers), std::move(body)};
+            req.method = (HTTPMethod)method;
+            req.raw_url.swap(raw_url);
+            req.url.swap(url);
+            req.url_params.swap(url_params);
+            req.headers.swap(headers);
+            req.body.swap(body);
         }
 
 		bool is_upgrade() const
@@ -7292,9 +7559,8 @@ namespace crow
         std::string raw_url;
         std::string url;
 
+        // 0 after a header value, 1 after a field name.
         int header_building_state = 0;
-        std::string header_field;
-        std::string header_value;
         ci_map headers;
         query_string url_params;
         std::string body;
@@ -7306,8 +7572,14 @@ namespace crow
 
 
 #pragma once
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 
 
@@ -7318,6 +7590,122 @@ namespace crow
 
 namespace crow
 {
+    // Body sent while it is produced. A producer thread write()s chunks and
+    // close()s the stream, the connection sends them with chunked transfer
+    // encoding. write() blocks while more than limit bytes are queued, so a
+    // response of any size needs bounded memory.
+    class body_stream
+    {
+    public:
+        explicit body_stream(size_t limit = 256*1024, std::chrono::seconds timeout = std::chrono::seconds(30))
+            : limit_(limit), timeout_(timeout)
+        {
+        }
+
+        // False once the client is gone or has not read for the timeout,
+        // the producer should stop then.
+        bool write(std::string chunk)
+        {
+            if (chunk.empty())
+                return true;
+            std::function<void()> notify;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (!space_.wait_for(lock, timeout_, [this]{ return cancelled_ || queued_ < limit_; }))
+                    cancelled_ = true;
+                if (cancelled_)
+                    return false;
+                queued_ += chunk.size();
+                chunks_.push_back(std::move(chunk));
+                notify.swap(notify_);
+            }
+            if (notify)
+                notify();
+            return true;
+        }
+
+        // The body is complete.
+        void close()
+        {
+            std::function<void()> notify;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                closed_ = true;
+                notify.swap(notify_);
+            }
+            if (notify)
+                notify();
+        }
+
+        // The body is incomplete, e.g. the producer failed. The connection
+        // is closed without the last chunk, so the client cannot take what
+        // it got for the whole body.
+        void abort()
+        {
+            std::function<void()> notify;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                aborted_ = true;
+                notify.swap(notify_);
+            }
+            if (notify)
+                notify();
+        }
+
+        // True once write() failed, the body cannot be complete then.
+        bool cancelled()
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            return cancelled_;
+        }
+
+        // Called by the connection when it cannot send any more.
+        void cancel()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                cancelled_ = true;
+                notify_ = nullptr;
+            }
+            space_.notify_all();
+        }
+
+        // Moves the queued chunks to out. If there are none and the body is
+        // neither complete nor aborted, returns false and calls notify once
+        // there are.
+        bool take(std::vector<std::string>& out, bool& closed, bool& aborted, std::function<void()> notify)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                closed = closed_;
+                aborted = aborted_;
+                if (chunks_.empty() && !closed_ && !aborted_)
+                {
+                    notify_ = std::move(notify);
+                    return false;
+                }
+                for (auto& chunk : chunks_)
+                    out.push_back(std::move(chunk));
+                chunks_.clear();
+                queued_ = 0;
+            }
+            space_.notify_all();
+            return true;
+        }
+
+    private:
+        std::mutex mutex_;
+        std::condition_variable space_;
+        std::deque<std::string> chunks_;
+        size_t queued_{};
+        size_t limit_;
+        std::chrono::seconds timeout_;
+        bool closed_{};
+        bool aborted_{};
+        bool cancelled_{};
+        std::function<void()> notify_;
+    };
+
     template <typename Adaptor, typename Handler, typename ... Middlewares>
     class Connection;
     struct response
@@ -7328,6 +7716,10 @@ namespace crow
         int code{200};
         std::string body;
         json::wvalue json_value;
+        // Written instead of body if set, e.g. one result sent to many clients.
+        std::shared_ptr<const std::string> shared_body;
+        // Sent chunk by chunk instead of body if set.
+        std::shared_ptr<body_stream> stream;
 
         // `headers' stores HTTP headers.
         ci_map headers;
@@ -7376,6 +7768,8 @@ namespace crow
         {
             body = std::move(r.body);
             json_value = std::move(r.json_value);
+            shared_body = std::move(r.shared_body);
+            stream = std::move(r.stream);
             code = r.code;
             headers = std::move(r.headers);
             completed_ = r.completed_;
@@ -7391,6 +7785,8 @@ namespace crow
         {
             body.clear();
             json_value.clear();
+            shared_body.reset();
+            stream.reset();
             code = 200;
             headers.clear();
             completed_ = false;
@@ -7647,6 +8043,157 @@ namespace crow
 
 
 
+#pragma once
+#ifdef CROW_ENABLE_COMPRESSION
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <zlib.h>
+
+namespace crow
+{
+    namespace compression
+    {
+        // Values are the zlib window bits, 16 more selects the gzip wrapper.
+        enum algorithm
+        {
+            DEFLATE = 15,
+            GZIP = 15|16,
+        };
+
+        inline const char* name(algorithm algo)
+        {
+            return algo == GZIP ? "gzip" : "deflate";
+        }
+
+        using compress_function = std::function<std::shared_ptr<const std::string>()>;
+        // Returns the encoded body stored under key, or stores and returns compress().
+        using cache_function = std::function<std::shared_ptr<const std::string>(const std::string& key, const compress_function& compress)>;
+
+        struct settings
+        {
+            // Smallest body worth encoding, 0 disables compression.
+            size_t min_size = 0;
+            int level = Z_BEST_SPEED;
+            cache_function cache;
+        };
+
+        // Picks the coding the client prefers from an Accept-Encoding value,
+        // gzip on a tie. False if the body has to be sent as is. A "*" only
+        // stands for the codings the client does not name, wherever it is.
+        inline bool negotiate(const std::string& accept_encoding, algorithm& algo)
+        {
+            // -1 while not named.
+            double gzip = -1, deflate = -1, any = -1;
+            size_t pos = 0;
+            while (pos < accept_encoding.size())
+            {
+                size_t end = accept_encoding.find(',', pos);
+                if (end == std::string::npos)
+                    end = accept_encoding.size();
+                std::string coding = accept_encoding.substr(pos, end - pos);
+                pos = end + 1;
+
+                double q = 1;
+                const size_t params = coding.find(';');
+                if (params != std::string::npos)
+                {
+                    const size_t qpos = coding.find("q=", params);
+                    if (qpos != std::string::npos)
+                        q = std::strtod(coding.c_str() + qpos + 2, nullptr);
+                    coding.resize(params);
+                }
+                boost::algorithm::trim(coding);
+                boost::algorithm::to_lower(coding);
+                if (coding == "gzip" || coding == "x-gzip")
+                    gzip = q;
+                else if (coding == "deflate")
+                    deflate = q;
+                else if (coding == "*")
+                    any = q;
+            }
+            if (gzip < 0)
+                gzip = any;
+            if (deflate < 0)
+                deflate = any;
+            if (gzip <= 0 && deflate <= 0)
+                return false;
+            algo = gzip >= deflate ? GZIP : DEFLATE;
+            return true;
+        }
+
+        // Encodes a body that arrives in pieces, e.g. a body_stream.
+        class deflater
+        {
+        public:
+            deflater(algorithm algo, int level)
+            {
+                ok_ = deflateInit2(&stream_, level, Z_DEFLATED, algo, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+            }
+
+            ~deflater()
+            {
+                if (ok_)
+                    deflateEnd(&stream_);
+            }
+
+            deflater(const deflater&) = delete;
+            deflater& operator = (const deflater&) = delete;
+
+            // Appends the encoding of in to out, flushed so the client can
+            // decode everything sent so far. finish ends the encoded stream.
+            bool deflate(const std::string& in, std::string& out, bool finish)
+            {
+                if (!ok_)
+                    return false;
+                stream_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+                stream_.avail_in = static_cast<uInt>(in.size());
+                int ret;
+                do
+                {
+                    const size_t start = out.size();
+                    out.resize(start + deflateBound(&stream_, stream_.avail_in) + 64);
+                    stream_.next_out = reinterpret_cast<Bytef*>(&out[start]);
+                    stream_.avail_out = static_cast<uInt>(out.size() - start);
+                    ret = ::deflate(&stream_, finish ? Z_FINISH : Z_SYNC_FLUSH);
+                    out.resize(out.size() - stream_.avail_out);
+                }
+                while (ret == Z_OK && stream_.avail_out == 0);
+                ok_ = finish ? ret == Z_STREAM_END : (ret == Z_OK || ret == Z_BUF_ERROR);
+                return ok_;
+            }
+
+        private:
+            z_stream stream_{};
+            bool ok_{};
+        };
+
+        // Empty if zlib failed.
+        inline std::string compress_string(const std::string& str, algorithm algo, int level)
+        {
+            std::string out;
+            z_stream stream{};
+            if (deflateInit2(&stream, level, Z_DEFLATED, algo, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+                return out;
+
+            // One call, the output is sized to the worst case up front.
+            out.resize(deflateBound(&stream, str.size()));
+            stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(str.data()));
+            stream.avail_in = static_cast<uInt>(str.size());
+            stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+            stream.avail_out = static_cast<uInt>(out.size());
+            const int ret = deflate(&stream, Z_FINISH);
+            out.resize(ret == Z_STREAM_END ? stream.total_out : 0);
+            deflateEnd(&stream);
+            return out;
+        }
+    }
+}
+#endif
+
+
+
 #pragma once
 #include <boost/asio.hpp>
 #include <boost/algorithm/string/predicate.hpp>
@@ -7654,6 +8201,7 @@ namespace crow
 #include <boost/array.hpp>
 #include <atomic>
 #include <chrono>
+#include <mutex>
 #include <vector>
 
 
@@ -7832,6 +8380,60 @@ namespace crow
         }
     }
 
+    namespace detail
+    {
+        // Closed connections of one io_service, reset and kept for the next
+        // accepted socket together with their buffers. The acceptor takes
+        // them, the io_service thread gives them back.
+        template <typename T>
+        class connection_pool
+        {
+        public:
+            explicit connection_pool(size_t capacity)
+                : capacity_(capacity)
+            {
+            }
+
+            ~connection_pool()
+            {
+                for(auto p : free_)
+                    delete p;
+            }
+
+            T* take()
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (free_.empty())
+                    return nullptr;
+                T* p = free_.back();
+                free_.pop_back();
+                reused_ ++;
+                return p;
+            }
+
+            // False if the pool is full, the caller deletes p then.
+            bool give(T* p)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (free_.size() >= capacity_)
+                    return false;
+                free_.push_back(p);
+                return true;
+            }
+
+            size_t reused() const
+            {
+                return reused_;
+            }
+
+        private:
+            std::mutex mutex_;
+            std::vector<T*> free_;
+            size_t capacity_;
+            std::atomic<size_t> reused_{0};
+        };
+    }
+
 #ifdef CROW_ENABLE_DEBUG
     static std::atomic<int> connectionCount;
 #endif
@@ -7844,9 +8446,10 @@ namespace crow
             Handler* handler, 
             const std::string& server_name,
             std::tuple<Middlewares...>* middlewares,
-            std::function<std::string()>& get_cached_date_str_f,
+            std::function<const std::string&()>& get_cached_date_str_f,
             detail::dumb_timer_queue& timer_queue,
-            typename Adaptor::context* adaptor_ctx_
+            typename Adaptor::context* adaptor_ctx_,
+            detail::connection_pool<Connection>* pool = nullptr
             ) 
             : adaptor_(io_service, adaptor_ctx_), 
             handler_(handler), 
@@ -7854,7 +8457,8 @@ namespace crow
             server_name_(server_name),
             middlewares_(middlewares),
             get_cached_date_str(get_cached_date_str_f),
-            timer_queue(timer_queue)
+            timer_queue(timer_queue),
+            pool_(pool)
         {
 #ifdef CROW_ENABLE_DEBUG
             connectionCount ++;
@@ -7865,6 +8469,8 @@ namespace crow
         ~Connection()
         {
             res.complete_request_handler_ = nullptr;
+            if (stream_)
+                stream_->cancel();
             cancel_deadline_timer();
 #ifdef CROW_ENABLE_DEBUG
             connectionCount --;
@@ -7911,7 +8517,7 @@ namespace crow
             bool is_invalid_request = false;
             add_keep_alive_ = false;
 
-            req_ = std::move(parser_.to_request());
+            parser_.to_request(req_);
             request& req = req_;
 
             if (parser_.check_version(1, 0))
@@ -7976,8 +8582,6 @@ namespace crow
                     res.complete_request_handler_ = [this]{ this->complete_request(); };
                     need_to_call_after_handlers_ = true;
                     handler_->handle(req, res);
-                    if (add_keep_alive_)
-                        res.set_header("connection", "Keep-Alive");
                 }
                 else
                 {
@@ -7990,6 +8594,56 @@ namespace crow
             }
         }
 
+#ifdef CROW_ENABLE_COMPRESSION
+        // Encodes a large enough body with the coding the client prefers.
+        // Bodies of responses with a strong ETag only change along with the
+        // tag, so their encodings come from the app's cache.
+        void compress_response()
+        {
+            const compression::settings& settings = handler_->compression_settings();
+            const std::string& body = res.shared_body ? *res.shared_body : res.body;
+            if (settings.min_size == 0 || res.code != 200 || (!res.stream && body.size() < settings.min_size) ||
+                res.headers.count("content-encoding"))
+                return;
+
+            res.set_header("Vary", "Accept-Encoding");
+            compression::algorithm algo;
+            if (!compression::negotiate(req_.get_header_value("Accept-Encoding"), algo))
+                return;
+
+            const std::string tag = res.get_header_value("ETag");
+            if (!tag.empty() && tag[0] == '"')
+                res.set_header("ETag", "W/" + tag);
+            if (res.stream)
+            {
+                // Streams are encoded chunk by chunk as they are sent.
+                stream_deflater_.reset(new compression::deflater(algo, settings.level));
+                res.set_header("Content-Encoding", compression::name(algo));
+                return;
+            }
+
+            auto compress = [&]
+            {
+                return std::make_shared<const std::string>(compression::compress_string(body, algo, settings.level));
+            };
+            std::shared_ptr<const std::string> encoded;
+            if (settings.cache && !tag.empty() && tag[0] == '"')
+                encoded = settings.cache(tag + compression::name(algo), compress);
+            else
+                encoded = compress();
+            if (encoded->empty() || encoded->size() >= body.size())
+            {
+                res.set_header("ETag", tag);
+                return;
+            }
+
+            // The encoded body is a different representation, its tag is weak.
+            res.set_header("Content-Encoding", compression::name(algo));
+            res.shared_body = std::move(encoded);
+            res.body.clear();
+        }
+#endif
+
         void complete_request()
         {
             CROW_LOG_INFO << "Response: " << this << ' ' << req_.raw_url << ' ' << res.code << ' ' << close_connection_;
@@ -8013,6 +8667,8 @@ namespace crow
             {
                 //CROW_LOG_DEBUG << this << " delete (socket is closed) " << is_reading << ' ' << is_writing;
                 //delete this;
+                if (res.stream)
+                    res.stream->cancel();
                 return;
             }
 
@@ -8041,11 +8697,11 @@ namespace crow
                 {503, "HTTP/1.1 503 Service Unavailable\r\n"},
             };
 
-            static std::string seperator = ": ";
-            static std::string crlf = "\r\n";
-
+            // The status line and the headers go out as one buffer. asio
+            // writes at most 16 buffers at once, a second write would wait
+            // for the ACK of the first one.
             buffers_.clear();
-            buffers_.reserve(4*(res.headers.size()+5)+3);
+            res_head_.clear();
 
             if (res.body.empty() && res.json_value.t() == json::type::Object)
             {
@@ -8055,55 +8711,92 @@ namespace crow
             if (!statusCodes.count(res.code))
                 res.code = 500;
             {
-                auto& status = statusCodes.find(res.code)->second;
-                buffers_.emplace_back(status.data(), status.size());
+                res_head_ += statusCodes.find(res.code)->second;
             }
 
-            if (res.code >= 400 && res.body.empty())
+            if (res.code >= 400 && res.body.empty() && !res.shared_body)
                 res.body = statusCodes[res.code].substr(9);
 
+#ifdef CROW_ENABLE_COMPRESSION
+            compress_response();
+#endif
+
             for(auto& kv : res.headers)
             {
-                buffers_.emplace_back(kv.first.data(), kv.first.size());
-                buffers_.emplace_back(seperator.data(), seperator.size());
-                buffers_.emplace_back(kv.second.data(), kv.second.size());
-                buffers_.emplace_back(crlf.data(), crlf.size());
-
+                res_head_ += kv.first;
+                res_head_ += ": ";
+                res_head_ += kv.second;
+                res_head_ += "\r\n";
             }
 
-            if (!res.headers.count("content-length"))
+            if (res.stream)
+            {
+                // Without chunked encoding the end of the body is the end
+                // of the connection.
+                if (parser_.check_version(1, 1))
+                {
+                    res_head_ += "Transfer-Encoding: chunked\r\n";
+                    stream_chunked_ = true;
+                }
+                else
+                {
+                    close_connection_ = true;
+                    add_keep_alive_ = false;
+                    stream_chunked_ = false;
+                }
+            }
+            else if (!res.headers.count("content-length"))
             {
-                content_length_ = std::to_string(res.body.size());
-                static std::string content_length_tag = "Content-Length: ";
-                buffers_.emplace_back(content_length_tag.data(), content_length_tag.size());
-                buffers_.emplace_back(content_length_.data(), content_length_.size());
-                buffers_.emplace_back(crlf.data(), crlf.size());
+                char length[24];
+                snprintf(length, sizeof(length), "%zu", res.shared_body ? res.shared_body->size() : res.body.size());
+                res_head_ += "Content-Length: ";
+                res_head_ += length;
+                res_head_ += "\r\n";
             }
             if (!res.headers.count("server"))
             {
-                static std::string server_tag = "Server: ";
-                buffers_.emplace_back(server_tag.data(), server_tag.size());
-                buffers_.emplace_back(server_name_.data(), server_name_.size());
-                buffers_.emplace_back(crlf.data(), crlf.size());
+                res_head_ += "Server: ";
+                res_head_ += server_name_;
+                res_head_ += "\r\n";
             }
             if (!res.headers.count("date"))
             {
-                static std::string date_tag = "Date: ";
-                date_str_ = get_cached_date_str();
-                buffers_.emplace_back(date_tag.data(), date_tag.size());
-                buffers_.emplace_back(date_str_.data(), date_str_.size());
-                buffers_.emplace_back(crlf.data(), crlf.size());
+                res_head_ += "Date: ";
+                res_head_ += get_cached_date_str();
+                res_head_ += "\r\n";
             }
             if (add_keep_alive_)
             {
-                static std::string keep_alive_tag = "Connection: Keep-Alive";
-                buffers_.emplace_back(keep_alive_tag.data(), keep_alive_tag.size());
-                buffers_.emplace_back(crlf.data(), crlf.size());
+                res_head_ += "Connection: Keep-Alive\r\n";
             }
 
-            buffers_.emplace_back(crlf.data(), crlf.size());
-            res_body_copy_.swap(res.body);
-            buffers_.emplace_back(res_body_copy_.data(), res_body_copy_.size());
+            res_head_ += "\r\n";
+            buffers_.emplace_back(res_head_.data(), res_head_.size());
+            if (res.stream)
+            {
+                stream_ = std::move(res.stream);
+                is_writing = true;
+                boost::asio::async_write(adaptor_.socket(), buffers_,
+                    [this](const boost::system::error_code& ec, std::size_t /*bytes_transferred*/)
+                    {
+                        if (ec)
+                            finish_stream(false);
+                        else
+                            do_write_stream();
+                    });
+                // Reading resumes once the stream is done.
+                return;
+            }
+            if (res.shared_body)
+            {
+                res_shared_body_ = std::move(res.shared_body);
+                buffers_.emplace_back(res_shared_body_->data(), res_shared_body_->size());
+            }
+            else
+            {
+                res_body_copy_.swap(res.body);
+                buffers_.emplace_back(res_body_copy_.data(), res_body_copy_.size());
+            }
 
             do_write();
 
@@ -8147,10 +8840,13 @@ namespace crow
                         cancel_deadline_timer();
                         parser_.done();
                         is_reading = false;
-                        check_destroy();
+                        // A response still being produced deletes the
+                        // connection once it is written.
+                        if (!need_to_call_after_handlers_)
+                            check_destroy();
                         // adaptor will close after write
                     }
-                    else if (!need_to_call_after_handlers_)
+                    else if (!need_to_call_after_handlers_ && !stream_)
                     {
                         start_deadline();
                         do_read();
@@ -8173,6 +8869,7 @@ namespace crow
                     is_writing = false;
                     res.clear();
                     res_body_copy_.clear();
+                    res_shared_body_.reset();
                     if (!ec)
                     {
                         if (close_connection_)
@@ -8190,16 +8887,138 @@ namespace crow
                 });
         }
 
+        // Sends the chunks the producer queued so far, then waits for more
+        // until the stream is closed. is_writing stays set all along.
+        void do_write_stream()
+        {
+            stream_chunks_.clear();
+            bool closed = false;
+            bool aborted = false;
+            auto* io_service = &adaptor_.get_io_service();
+            if (!stream_->take(stream_chunks_, closed, aborted, [this, io_service]{ io_service->post([this]{ do_write_stream(); }); }))
+                return;
+            if (aborted || !adaptor_.is_open())
+            {
+                finish_stream(false);
+                return;
+            }
+
+#ifdef CROW_ENABLE_COMPRESSION
+            if (stream_deflater_)
+            {
+                // One encoded chunk per batch, flushed for the client.
+                std::string encoded;
+                for (auto& chunk : stream_chunks_)
+                {
+                    if (!stream_deflater_->deflate(chunk, encoded, false))
+                        break;
+                }
+                if (closed)
+                    stream_deflater_->deflate(std::string(), encoded, true);
+                stream_chunks_.clear();
+                if (!encoded.empty())
+                    stream_chunks_.push_back(std::move(encoded));
+            }
+#endif
+
+            static std::string crlf = "\r\n";
+            static std::string last_chunk = "0\r\n\r\n";
+            buffers_.clear();
+            stream_sizes_.clear();
+            stream_sizes_.reserve(stream_chunks_.size());
+            for (auto& chunk : stream_chunks_)
+            {
+                if (stream_chunked_)
+                {
+                    char size[20];
+                    snprintf(size, sizeof(size), "%zx\r\n", chunk.size());
+                    stream_sizes_.emplace_back(size);
+                    buffers_.emplace_back(stream_sizes_.back().data(), stream_sizes_.back().size());
+                }
+                buffers_.emplace_back(chunk.data(), chunk.size());
+                if (stream_chunked_)
+                    buffers_.emplace_back(crlf.data(), crlf.size());
+            }
+            if (closed && stream_chunked_)
+                buffers_.emplace_back(last_chunk.data(), last_chunk.size());
+
+            boost::asio::async_write(adaptor_.socket(), buffers_,
+                [this, closed](const boost::system::error_code& ec, std::size_t /*bytes_transferred*/)
+                {
+                    if (ec || closed)
+                        finish_stream(!ec);
+                    else
+                        do_write_stream();
+                });
+        }
+
+        void finish_stream(bool ok)
+        {
+            if (!ok)
+                stream_->cancel();
+            stream_.reset();
+            stream_chunks_.clear();
+            stream_sizes_.clear();
+#ifdef CROW_ENABLE_COMPRESSION
+            stream_deflater_.reset();
+#endif
+            is_writing = false;
+            res.clear();
+            if (!ok || close_connection_)
+                adaptor_.close();
+            if (need_to_start_read_after_complete_)
+            {
+                // On a closed socket the read fails and cleans up.
+                need_to_start_read_after_complete_ = false;
+                start_deadline();
+                do_read();
+            }
+            else
+            {
+                check_destroy();
+            }
+        }
+
         void check_destroy()
         {
             CROW_LOG_DEBUG << this << " is_reading " << is_reading << " is_writing " << is_writing;
             if (!is_reading && !is_writing)
             {
                 CROW_LOG_DEBUG << this << " delete (idle) ";
-                delete this;
+                if (!pool_ || !reset() || !pool_->give(this))
+                    delete this;
             }
         }
 
+        // Readies a closed connection for the next socket, false if it
+        // cannot be reused.
+        bool reset()
+        {
+            if (!adaptor_.reset())
+                return false;
+            cancel_deadline_timer();
+            parser_.reset();
+            res.clear();
+            res.complete_request_handler_ = nullptr;
+            res.is_alive_helper_ = nullptr;
+            close_connection_ = false;
+            buffers_.clear();
+            res_body_copy_.clear();
+            res_shared_body_.reset();
+            stream_.reset();
+            stream_chunks_.clear();
+            stream_sizes_.clear();
+            stream_chunked_ = false;
+#ifdef CROW_ENABLE_COMPRESSION
+            stream_deflater_.reset();
+#endif
+            need_to_call_after_handlers_ = false;
+            need_to_start_read_after_complete_ = false;
+            add_keep_alive_ = false;
+            ctx_ = detail::context<Middlewares...>();
+            return true;
+        }
+
         void cancel_deadline_timer()
         {
             CROW_LOG_DEBUG << this << " timer cancelled: " << timer_cancel_key_.first << ' ' << timer_cancel_key_.second;
@@ -8236,9 +9055,16 @@ namespace crow
         const std::string& server_name_;
         std::vector<boost::asio::const_buffer> buffers_;
 
-        std::string content_length_;
-        std::string date_str_;
+        std::string res_head_;
         std::string res_body_copy_;
+        std::shared_ptr<const std::string> res_shared_body_;
+        std::shared_ptr<body_stream> stream_;
+        std::vector<std::string> stream_chunks_;
+        std::vector<std::string> stream_sizes_;
+        bool stream_chunked_{};
+#ifdef CROW_ENABLE_COMPRESSION
+        std::unique_ptr<compression::deflater> stream_deflater_;
+#endif
 
         //boost::asio::deadline_timer deadline_;
         detail::dumb_timer_queue::key timer_cancel_key_;
@@ -8252,8 +9078,9 @@ namespace crow
         std::tuple<Middlewares...>* middlewares_;
         detail::context<Middlewares...> ctx_;
 
-        std::function<std::string()>& get_cached_date_str;
+        std::function<const std::string&()>& get_cached_date_str;
         detail::dumb_timer_queue& timer_queue;
+        detail::connection_pool<Connection>* pool_;
     };
 
 }
@@ -8272,6 +9099,10 @@ namespace crow
 #include <atomic>
 #include <future>
 #include <vector>
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include <memory>
 
@@ -8290,9 +9121,17 @@ namespace crow
     template <typename Handler, typename Adaptor = SocketAdaptor, typename ... Middlewares>
     class Server
     {
+        using connection_t = Connection<Adaptor, Handler, Middlewares...>;
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+        using local_connection_t = Connection<UnixSocketAdaptor, Handler, Middlewares...>;
+#endif
     public:
     Server(Handler* handler, std::string bindaddr, uint16_t port, std::tuple<Middlewares...>* middlewares = nullptr, uint16_t concurrency = 1, typename Adaptor::context* adaptor_ctx = nullptr)
-            : acceptor_(io_service_, tcp::endpoint(boost::asio::ip::address::from_string(bindaddr), port)),
+            : endpoint_(boost::asio::ip::address::from_string(bindaddr), port),
+            acceptor_(io_service_),
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+            local_acceptor_(io_service_),
+#endif
             signals_(io_service_, SIGINT, SIGTERM),
             tick_timer_(io_service_),
             handler_(handler),
@@ -8310,6 +9149,52 @@ namespace crow
             tick_function_ = f;
         }
 
+        // Closed connections kept for reuse per thread, 0 deletes them.
+        void set_connection_pool_size(size_t size)
+        {
+            connection_pool_size_ = size;
+        }
+
+        // Every thread accepts on a socket of its own bound with
+        // SO_REUSEPORT instead of taking sockets from the main thread. The
+        // kernel spreads the connections, each stays on the thread that
+        // accepted it.
+        void set_reuse_port(bool reuse_port)
+        {
+            reuse_port_ = reuse_port;
+        }
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+        // Also accepts plain HTTP on a Unix domain socket at path, served by
+        // the same threads. The socket file gets the permission bits mode,
+        // a stale socket file is replaced and removed again on exit.
+        void set_unix_socket(std::string path, mode_t mode)
+        {
+            local_path_ = std::move(path);
+            local_mode_ = mode;
+        }
+#endif
+
+        // Called on each io thread with its index before it serves, and
+        // with -1 on the thread running the main io_service.
+        void set_thread_init(std::function<void(int)> f)
+        {
+            thread_init_ = f;
+        }
+
+        // Accepted sockets served by a reused connection.
+        size_t connections_reused() const
+        {
+            size_t reused = 0;
+            for(auto& pool : connection_pools_)
+                reused += pool->reused();
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+            for(auto& pool : local_connection_pools_)
+                reused += pool->reused();
+#endif
+            return reused;
+        }
+
         void on_tick()
         {
             tick_function_();
@@ -8331,6 +9216,34 @@ namespace crow
                 io_service_pool_.emplace_back(new boost::asio::io_service());
             get_cached_date_str_pool_.resize(concurrency_);
             timer_queue_pool_.resize(concurrency_);
+            for(int i = 0; i < concurrency_;  i++)
+                connection_pools_.emplace_back(new detail::connection_pool<connection_t>(connection_pool_size_));
+
+#ifdef SO_REUSEPORT
+            if (reuse_port_)
+            {
+                for(int i = 0; i < concurrency_;  i++)
+                {
+                    acceptors_.emplace_back(new tcp::acceptor(*io_service_pool_[i]));
+                    listen(*acceptors_.back(), true);
+                }
+            }
+            else
+#else
+            if (reuse_port_)
+                CROW_LOG_WARNING << "SO_REUSEPORT is not supported, accepting on one thread";
+#endif
+            {
+                listen(acceptor_, false);
+            }
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+            if (!local_path_.empty())
+            {
+                for(int i = 0; i < concurrency_;  i++)
+                    local_connection_pools_.emplace_back(new detail::connection_pool<local_connection_t>(connection_pool_size_));
+                listen_local();
+            }
+#endif
 
             std::vector<std::future<void>> v;
             std::atomic<int> init_count(0);
@@ -8357,7 +9270,7 @@ namespace crow
                                 date_str.resize(date_str_sz);
                             };
                             update_date_str();
-                            get_cached_date_str_pool_[i] = [&]()->std::string
+                            get_cached_date_str_pool_[i] = [&]()->const std::string&
                             {
                                 if (std::chrono::steady_clock::now() - last >= std::chrono::seconds(1))
                                 {
@@ -8385,6 +9298,8 @@ namespace crow
                             };
                             timer.async_wait(handler);
 
+                            if (thread_init_)
+                                thread_init_(i);
                             init_count ++;
                             while(1)
                             {
@@ -8414,7 +9329,11 @@ namespace crow
             }
 
             CROW_LOG_INFO << server_name_ << " server is running at " << bindaddr_ <<":" << port_
-                          << " using " << concurrency_ << " threads";
+                          << " using " << concurrency_ << " threads" << (acceptors_.empty() ? "" : ", each accepting");
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+            if (!local_path_.empty())
+                CROW_LOG_INFO << server_name_ << " server is also running at unix:" << local_path_;
+#endif
             CROW_LOG_INFO << "Call `app.loglevel(crow::LogLevel::Warning)` to hide Info level logs.";
 
             signals_.async_wait(
@@ -8425,12 +9344,26 @@ namespace crow
             while(concurrency_ != init_count)
                 std::this_thread::yield();
 
-            do_accept();
+            if (acceptors_.empty())
+                do_accept();
+            for(unsigned i = 0; i < acceptors_.size(); i ++)
+                do_accept(i);
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+            if (local_acceptor_.is_open())
+                do_accept_local();
+#endif
 
             std::thread([this]{
+                if (thread_init_)
+                    thread_init_(-1);
                 io_service_.run();
                 CROW_LOG_INFO << "Exiting.";
             }).join();
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+            if (local_acceptor_.is_open())
+                ::unlink(local_path_.c_str());
+#endif
         }
 
         void stop()
@@ -8450,13 +9383,105 @@ namespace crow
             return *io_service_pool_[roundrobin_index_];
         }
 
+        void listen(tcp::acceptor& acceptor, bool reuse_port)
+        {
+            acceptor.open(endpoint_.protocol());
+            acceptor.set_option(tcp::acceptor::reuse_address(true));
+#ifdef SO_REUSEPORT
+            if (reuse_port)
+                acceptor.set_option(asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true));
+#else
+            (void)reuse_port;
+#endif
+            acceptor.bind(endpoint_);
+            acceptor.listen();
+        }
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+        void listen_local()
+        {
+            // Left behind by a server that did not exit cleanly. Any other
+            // file stays and the bind fails.
+            struct stat st;
+            if (::lstat(local_path_.c_str(), &st) == 0 && S_ISSOCK(st.st_mode))
+                ::unlink(local_path_.c_str());
+
+            asio::local::stream_protocol::endpoint endpoint(local_path_);
+            local_acceptor_.open(endpoint.protocol());
+            local_acceptor_.bind(endpoint);
+            // Before listen(), clients cannot connect while the file still
+            // has the permissions of the umask.
+            if (::chmod(local_path_.c_str(), local_mode_) != 0)
+                CROW_LOG_WARNING << "chmod " << local_path_ << " failed: " << strerror(errno);
+            local_acceptor_.listen();
+        }
+
+        local_connection_t* make_local_connection(unsigned index)
+        {
+            auto& pool = *local_connection_pools_[index];
+            auto p = pool.take();
+            if (!p)
+                p = new local_connection_t(
+                    *io_service_pool_[index], handler_, server_name_, middlewares_,
+                    get_cached_date_str_pool_[index], *timer_queue_pool_[index],
+                    nullptr, connection_pool_size_ ? &pool : nullptr);
+            return p;
+        }
+
+        void do_accept_local()
+        {
+            asio::io_service& is = pick_io_service();
+            auto p = make_local_connection(roundrobin_index_);
+            local_acceptor_.async_accept(p->socket(),
+                [this, p, &is](boost::system::error_code ec)
+                {
+                    if (!ec)
+                    {
+                        is.post([p]
+                        {
+                            p->start();
+                        });
+                    }
+                    else
+                    {
+                        delete p;
+                    }
+                    do_accept_local();
+                });
+        }
+#endif
+
+        connection_t* make_connection(unsigned index)
+        {
+            auto& pool = *connection_pools_[index];
+            auto p = pool.take();
+            if (!p)
+                p = new connection_t(
+                    *io_service_pool_[index], handler_, server_name_, middlewares_,
+                    get_cached_date_str_pool_[index], *timer_queue_pool_[index],
+                    adaptor_ctx_, connection_pool_size_ ? &pool : nullptr);
+            return p;
+        }
+
+        // Accepts on the acceptor of thread index, on that thread.
+        void do_accept(unsigned index)
+        {
+            auto p = make_connection(index);
+            acceptors_[index]->async_accept(p->socket(),
+                [this, p, index](boost::system::error_code ec)
+                {
+                    if (!ec)
+                        p->start();
+                    else
+                        delete p;
+                    do_accept(index);
+                });
+        }
+
         void do_accept()
         {
             asio::io_service& is = pick_io_service();
-            auto p = new Connection<Adaptor, Handler, Middlewares...>(
-                is, handler_, server_name_, middlewares_,
-                get_cached_date_str_pool_[roundrobin_index_], *timer_queue_pool_[roundrobin_index_],
-                adaptor_ctx_);
+            auto p = make_connection(roundrobin_index_);
             acceptor_.async_accept(p->socket(),
                 [this, p, &is](boost::system::error_code ec)
                 {
@@ -8479,8 +9504,21 @@ namespace crow
         asio::io_service io_service_;
         std::vector<std::unique_ptr<asio::io_service>> io_service_pool_;
         std::vector<detail::dumb_timer_queue*> timer_queue_pool_;
-        std::vector<std::function<std::string()>> get_cached_date_str_pool_;
+        std::vector<std::function<const std::string&()>> get_cached_date_str_pool_;
+        // After the io_services, a pooled connection closes its socket first.
+        std::vector<std::unique_ptr<detail::connection_pool<connection_t>>> connection_pools_;
+        size_t connection_pool_size_{0};
+        // One per thread with SO_REUSEPORT, acceptor_ stays closed then.
+        std::vector<std::unique_ptr<tcp::acceptor>> acceptors_;
+        bool reuse_port_{false};
+        tcp::endpoint endpoint_;
         tcp::acceptor acceptor_;
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+        std::vector<std::unique_ptr<detail::connection_pool<local_connection_t>>> local_connection_pools_;
+        std::string local_path_;
+        mode_t local_mode_{0660};
+        asio::local::stream_protocol::acceptor local_acceptor_;
+#endif
         boost::asio::signal_set signals_;
         boost::asio::deadline_timer tick_timer_;
 
@@ -8493,6 +9531,7 @@ namespace crow
 
         std::chrono::milliseconds tick_interval_;
         std::function<void()> tick_function_;
+        std::function<void(int)> thread_init_;
 
         std::tuple<Middlewares...>* middlewares_;
 
@@ -8557,6 +9596,13 @@ namespace crow
             res = response(404);
             res.end();
         }
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+        virtual void handle_upgrade(const request&, response& res, UnixSocketAdaptor&&)
+        {
+            res = response(404);
+            res.end();
+        }
+#endif
 #ifdef CROW_ENABLE_SSL
         virtual void handle_upgrade(const request&, response& res, SSLAdaptor&&) 
         {
@@ -8804,6 +9850,12 @@ namespace crow
         {
             new crow::websocket::Connection<SocketAdaptor>(req, std::move(adaptor), open_handler_, message_handler_, close_handler_, error_handler_, accept_handler_);
         }
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+        void handle_upgrade(const request& req, response&, UnixSocketAdaptor&& adaptor) override
+        {
+            new crow::websocket::Connection<UnixSocketAdaptor>(req, std::move(adaptor), open_handler_, message_handler_, close_handler_, error_handler_, accept_handler_);
+        }
+#endif
 #ifdef CROW_ENABLE_SSL
         void handle_upgrade(const request& req, response&, SSLAdaptor&& adaptor) override
         {
@@ -9157,28 +10209,31 @@ public:
             optimize();
         }
 
-        std::pair<unsigned, routing_params> find(const std::string& req_url, const Node* node = nullptr, unsigned pos = 0, routing_params* params = nullptr) const
+        // Finds the rule for req_url and its parameters. scratch holds the
+        // parameters of the path being tried. Both keep their storage, a
+        // connection matching its requests with the same ones does not
+        // allocate.
+        unsigned find(const std::string& req_url, routing_params& match, routing_params& scratch) const
         {
-            routing_params empty;
-            if (params == nullptr)
-                params = &empty;
-
+            match.clear(&req_url);
+            scratch.clear(&req_url);
             unsigned found{};
-            routing_params match_params;
+            find(req_url, head(), 0, scratch, found, match);
+            return found;
+        }
 
-            if (node == nullptr)
-                node = head();
+private:
+        void find(const std::string& req_url, const Node* node, unsigned pos, routing_params& params, unsigned& found, routing_params& match) const
+        {
             if (pos == req_url.size())
-                return {node->rule_index, *params};
-
-            auto update_found = [&found, &match_params](std::pair<unsigned, routing_params>& ret)
             {
-                if (ret.first && (!found || found > ret.first))
+                if (node->rule_index && (!found || found > node->rule_index))
                 {
-                    found = ret.first;
-                    match_params = std::move(ret.second);
+                    found = node->rule_index;
+                    match.assign(params);
                 }
-            };
+                return;
+            }
 
             if (node->param_childrens[(int)ParamType::INT])
             {
@@ -9190,10 +10245,9 @@ public:
                     long long int value = strtoll(req_url.data()+pos, &eptr, 10);
                     if (errno != ERANGE && eptr != req_url.data()+pos)
                     {
-                        params->int_params.push_back(value);
-                        auto ret = find(req_url, &nodes_[node->param_childrens[(int)ParamType::INT]], eptr - req_url.data(), params);
-                        update_found(ret);
-                        params->int_params.pop_back();
+                        params.int_params.push_back(value);
+                        find(req_url, &nodes_[node->param_childrens[(int)ParamType::INT]], eptr - req_url.data(), params, found, match);
+                        params.int_params.pop_back();
                     }
                 }
             }
@@ -9208,10 +10262,9 @@ public:
                     unsigned long long int value = strtoull(req_url.data()+pos, &eptr, 10);
                     if (errno != ERANGE && eptr != req_url.data()+pos)
                     {
-                        params->uint_params.push_back(value);
-                        auto ret = find(req_url, &nodes_[node->param_childrens[(int)ParamType::UINT]], eptr - req_url.data(), params);
-                        update_found(ret);
-                        params->uint_params.pop_back();
+                        params.uint_params.push_back(value);
+                        find(req_url, &nodes_[node->param_childrens[(int)ParamType::UINT]], eptr - req_url.data(), params, found, match);
+                        params.uint_params.pop_back();
                     }
                 }
             }
@@ -9226,10 +10279,9 @@ public:
                     double value = strtod(req_url.data()+pos, &eptr);
                     if (errno != ERANGE && eptr != req_url.data()+pos)
                     {
-                        params->double_params.push_back(value);
-                        auto ret = find(req_url, &nodes_[node->param_childrens[(int)ParamType::DOUBLE]], eptr - req_url.data(), params);
-                        update_found(ret);
-                        params->double_params.pop_back();
+                        params.double_params.push_back(value);
+                        find(req_url, &nodes_[node->param_childrens[(int)ParamType::DOUBLE]], eptr - req_url.data(), params, found, match);
+                        params.double_params.pop_back();
                     }
                 }
             }
@@ -9245,10 +10297,9 @@ public:
 
                 if (epos != pos)
                 {
-                    params->string_params.push_back(req_url.substr(pos, epos-pos));
-                    auto ret = find(req_url, &nodes_[node->param_childrens[(int)ParamType::STRING]], epos, params);
-                    update_found(ret);
-                    params->string_params.pop_back();
+                    params.string_params.emplace_back(pos, epos-pos);
+                    find(req_url, &nodes_[node->param_childrens[(int)ParamType::STRING]], epos, params, found, match);
+                    params.string_params.pop_back();
                 }
             }
 
@@ -9258,10 +10309,9 @@ public:
 
                 if (epos != pos)
                 {
-                    params->string_params.push_back(req_url.substr(pos, epos-pos));
-                    auto ret = find(req_url, &nodes_[node->param_childrens[(int)ParamType::PATH]], epos, params);
-                    update_found(ret);
-                    params->string_params.pop_back();
+                    params.string_params.emplace_back(pos, epos-pos);
+                    find(req_url, &nodes_[node->param_childrens[(int)ParamType::PATH]], epos, params, found, match);
+                    params.string_params.pop_back();
                 }
             }
 
@@ -9272,14 +10322,13 @@ public:
 
                 if (req_url.compare(pos, fragment.size(), fragment) == 0)
                 {
-                    auto ret = find(req_url, child, pos + fragment.size(), params);
-                    update_found(ret);
+                    find(req_url, child, pos + fragment.size(), params, found, match);
                 }
             }
-
-            return {found, match_params};
         }
 
+public:
+
         void add(const std::string& url, unsigned rule_index)
         {
             unsigned idx{0};
@@ -9482,8 +10531,7 @@ public:
             auto& trie = per_method.trie;
             auto& rules = per_method.rules;
 
-            auto found = trie.find(req.url);
-            unsigned rule_index = found.first;
+            unsigned rule_index = trie.find(req.url, req.route_params, req.route_scratch);
             if (!rule_index)
             {
                 CROW_LOG_DEBUG << "Cannot match rules " << req.url << ' ' << method_name(req.method);
@@ -9544,9 +10592,7 @@ public:
             auto& trie = per_method.trie;
             auto& rules = per_method.rules;
 
-            auto found = trie.find(req.url);
-
-            unsigned rule_index = found.first;
+            unsigned rule_index = trie.find(req.url, req.route_params, req.route_scratch);
 
             if (!rule_index)
             {
@@ -9582,7 +10628,7 @@ public:
             // any uncaught exceptions become 500s
             try
             {
-                rules[rule_index]->handle(req, res, found.second);
+                rules[rule_index]->handle(req, res, req.route_params);
             }
             catch(std::exception& e)
             {
@@ -9717,6 +10763,27 @@ namespace crow
             return concurrency(std::thread::hardware_concurrency());
         }
 
+#ifdef CROW_ENABLE_COMPRESSION
+        // Encodes bodies of at least min_size bytes if the client accepts it.
+        self_t& use_compression(size_t min_size = 1024, int level = Z_BEST_SPEED)
+        {
+            compression_.min_size = min_size;
+            compression_.level = level;
+            return *this;
+        }
+
+        self_t& compression_cache(compression::cache_function cache)
+        {
+            compression_.cache = std::move(cache);
+            return *this;
+        }
+
+        const compression::settings& compression_settings() const
+        {
+            return compression_;
+        }
+#endif
+
         self_t& concurrency(std::uint16_t concurrency)
         {
             if (concurrency < 1)
@@ -9725,6 +10792,49 @@ namespace crow
             return *this;
         }
 
+        // Closed connections each thread keeps for the next accepted socket,
+        // 0 deletes them.
+        self_t& connection_pool(size_t size)
+        {
+            connection_pool_size_ = size;
+            return *this;
+        }
+
+        // Accepts on every thread through SO_REUSEPORT.
+        self_t& reuse_port(bool enabled = true)
+        {
+            reuse_port_ = enabled;
+            return *this;
+        }
+
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+        // Serves plain HTTP on a Unix domain socket at path as well, e.g.
+        // for clients on the same host. mode sets the permission bits.
+        self_t& unix_socket(std::string path, mode_t mode = 0660)
+        {
+            unix_socket_path_ = std::move(path);
+            unix_socket_mode_ = mode;
+            return *this;
+        }
+#endif
+
+        // Runs f(index) on each io thread as it starts, f(-1) on the
+        // accepting thread, e.g. to set its CPU affinity.
+        self_t& thread_init(std::function<void(int)> f)
+        {
+            thread_init_ = std::move(f);
+            return *this;
+        }
+
+        size_t connections_reused() const
+        {
+#ifdef CROW_ENABLE_SSL
+            if (use_ssl_)
+                return ssl_server_ ? ssl_server_->connections_reused() : 0;
+#endif
+            return server_ ? server_->connections_reused() : 0;
+        }
+
         void validate()
         {
             router_.validate();
@@ -9745,6 +10855,13 @@ namespace crow
             {
                 ssl_server_ = std::move(std::unique_ptr<ssl_server_t>(new ssl_server_t(this, bindaddr_, port_, &middlewares_, concurrency_, &ssl_context_)));
                 ssl_server_->set_tick_function(tick_interval_, tick_function_);
+                ssl_server_->set_connection_pool_size(connection_pool_size_);
+                ssl_server_->set_reuse_port(reuse_port_);
+                ssl_server_->set_thread_init(thread_init_);
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+                if (!unix_socket_path_.empty())
+                    ssl_server_->set_unix_socket(unix_socket_path_, unix_socket_mode_);
+#endif
                 notify_server_start();
                 ssl_server_->run();
             }
@@ -9753,6 +10870,13 @@ namespace crow
             {
                 server_ = std::move(std::unique_ptr<server_t>(new server_t(this, bindaddr_, port_, &middlewares_, concurrency_, nullptr)));
                 server_->set_tick_function(tick_interval_, tick_function_);
+                server_->set_connection_pool_size(connection_pool_size_);
+                server_->set_reuse_port(reuse_port_);
+                server_->set_thread_init(thread_init_);
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+                if (!unix_socket_path_.empty())
+                    server_->set_unix_socket(unix_socket_path_, unix_socket_mode_);
+#endif
                 notify_server_start();
                 server_->run();
             }
@@ -9881,7 +11005,17 @@ namespace crow
     private:
         uint16_t port_ = 80;
         uint16_t concurrency_ = 1;
+        size_t connection_pool_size_ = 256;
+        bool reuse_port_ = false;
+        std::function<void(int)> thread_init_;
+#ifdef BOOST_ASIO_HAS_LOCAL_SOCKETS
+        std::string unix_socket_path_;
+        mode_t unix_socket_mode_ = 0660;
+#endif
         std::string bindaddr_ = "0.0.0.0";
+#ifdef CROW_ENABLE_COMPRESSION
+        compression::settings compression_;
+#endif
         Router router_;
 
         std::chrono::milliseconds tick_interval_;
@@ -12,6 +12,7 @@
 
 #include <git2/branch.h>
 #ifdef LIBGIT2_AVAILABLE
+#include <algorithm>
 #include <cstdio>
 #include <ctime>
 #include <git2/commit.h>
@@ -25,8 +26,15 @@
 #include <sstream>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
 #include <string>
 #include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "git2api.h"
 #include "utils.h"
@@ -55,8 +63,8 @@ void convert_git_time_to_string(const git_time* input, std::string& output)
   int h = offset / 60;
   int m = offset % 60;
   time_t t = static_cast<time_t>(input->time) + (input->offset * 60);
-  struct tm* gmt = gmtime(&t);
-  strftime(time, sizeof(time), "%a %b %e %T %Y", gmt);
+  struct tm gmt;
+  strftime(time, sizeof(time), "%a %b %e %T %Y", gmtime_r(&t, &gmt));
   output = time;
   output += " ";
   output += sign;
@@ -96,7 +104,215 @@ bool match_with_parent(git_commit* commit, uint32_t i, git_diff_options* opt)
   return (ndeltas > 0);
 }
 
-void print_log(std::stringstream& ss, git_commit* commit)
+/// Splits a literal path into its components, empty if it holds pathspec wildcards.
+std::vector<std::string> split_path(const std::string& file)
+{
+  std::vector<std::string> parts;
+  if (file.find_first_of("*?[\\") != std::string::npos)
+  {
+    return parts;
+  }
+
+  std::string::size_type begin = 0;
+  while (begin <= file.size())
+  {
+    std::string::size_type end = file.find('/', begin);
+    if (end == std::string::npos)
+    {
+      end = file.size();
+    }
+    if (end > begin && file.compare(begin, end - begin, ".") != 0)
+    {
+      parts.push_back(file.substr(begin, end - begin));
+    }
+    begin = end + 1;
+  }
+  return parts;
+}
+
+/// Compares the entry at \p parts between two trees, either may be null.
+/// Only the directory chain of the path is loaded, equal subtrees end the walk.
+bool path_differs(git_repository* repo, const git_tree* a, const git_tree* b,
+  const std::vector<std::string>& parts)
+{
+  git_tree* owned_a = nullptr;
+  git_tree* owned_b = nullptr;
+  bool differs = false;
+  for (size_t i = 0; i < parts.size(); ++i)
+  {
+    if (!a && !b)
+    {
+      break;
+    }
+    if (a && b && git_oid_equal(git_tree_id(a), git_tree_id(b)))
+    {
+      break;
+    }
+
+    const git_tree_entry* ea = a ? git_tree_entry_byname(a, parts[i].c_str()) : nullptr;
+    const git_tree_entry* eb = b ? git_tree_entry_byname(b, parts[i].c_str()) : nullptr;
+    if (i + 1 == parts.size())
+    {
+      if (!ea || !eb)
+      {
+        differs = (ea != eb);
+      }
+      else
+      {
+        differs = !git_oid_equal(git_tree_entry_id(ea), git_tree_entry_id(eb)) ||
+                  git_tree_entry_filemode(ea) != git_tree_entry_filemode(eb);
+      }
+      break;
+    }
+
+    git_tree* next_a = nullptr;
+    git_tree* next_b = nullptr;
+    if (ea && git_tree_entry_type(ea) == GIT_OBJECT_TREE)
+    {
+      git_tree_lookup(&next_a, repo, git_tree_entry_id(ea));
+    }
+    if (eb && git_tree_entry_type(eb) == GIT_OBJECT_TREE)
+    {
+      git_tree_lookup(&next_b, repo, git_tree_entry_id(eb));
+    }
+    git_tree_free(owned_a);
+    git_tree_free(owned_b);
+    a = owned_a = next_a;
+    b = owned_b = next_b;
+  }
+  git_tree_free(owned_a);
+  git_tree_free(owned_b);
+  return differs;
+}
+
+/// Same result as diffing the commit against every parent with a pathspec
+/// of the literal path: true if the path differs from all of them.
+bool touches_path(git_commit* commit, const std::vector<std::string>& parts)
+{
+  git_repository* repo = git_commit_owner(commit);
+  git_tree* tree = nullptr;
+  if (git_commit_tree(&tree, commit) != 0)
+  {
+    return false;
+  }
+
+  const uint32_t parents = git_commit_parentcount(commit);
+  bool touched = true;
+  if (parents == 0)
+  {
+    touched = path_differs(repo, nullptr, tree, parts);
+  }
+  for (uint32_t i = 0; i < parents && touched; ++i)
+  {
+    git_commit* parent = nullptr;
+    git_tree* parent_tree = nullptr;
+    if (git_commit_parent(&parent, commit, i) == 0 && git_commit_tree(&parent_tree, parent) == 0)
+    {
+      touched = path_differs(repo, parent_tree, tree, parts);
+    }
+    git_tree_free(parent_tree);
+    git_commit_free(parent);
+  }
+  git_tree_free(tree);
+  return touched;
+}
+
+void collect_changed(git_repository* repo, const git_tree* a, const git_tree* b,
+  const std::string& prefix, std::unordered_set<std::string>& paths);
+
+/// Adds the path of an entry that differs, or everything below it.
+void collect_entry(git_repository* repo, const git_tree_entry* ea, const git_tree_entry* eb,
+  const std::string& path, std::unordered_set<std::string>& paths)
+{
+  git_tree* ta = nullptr;
+  git_tree* tb = nullptr;
+  if (ea && git_tree_entry_type(ea) == GIT_OBJECT_TREE)
+  {
+    git_tree_lookup(&ta, repo, git_tree_entry_id(ea));
+  }
+  else if (ea)
+  {
+    paths.insert(path);
+  }
+  if (eb && git_tree_entry_type(eb) == GIT_OBJECT_TREE)
+  {
+    git_tree_lookup(&tb, repo, git_tree_entry_id(eb));
+  }
+  else if (eb)
+  {
+    paths.insert(path);
+  }
+  if (ta || tb)
+  {
+    collect_changed(repo, ta, tb, path + "/", paths);
+  }
+  git_tree_free(ta);
+  git_tree_free(tb);
+}
+
+/// Adds the paths whose entries differ between two trees, either may be
+/// null. Subtrees with equal oids are skipped without being loaded.
+void collect_changed(git_repository* repo, const git_tree* a, const git_tree* b,
+  const std::string& prefix, std::unordered_set<std::string>& paths)
+{
+  if (a && b && git_oid_equal(git_tree_id(a), git_tree_id(b)))
+  {
+    return;
+  }
+
+  const size_t nb = b ? git_tree_entrycount(b) : 0;
+  for (size_t i = 0; i < nb; ++i)
+  {
+    const git_tree_entry* eb = git_tree_entry_byindex(b, i);
+    const git_tree_entry* ea = a ? git_tree_entry_byname(a, git_tree_entry_name(eb)) : nullptr;
+    if (ea && git_oid_equal(git_tree_entry_id(ea), git_tree_entry_id(eb)) &&
+        git_tree_entry_filemode(ea) == git_tree_entry_filemode(eb))
+    {
+      continue;
+    }
+    collect_entry(repo, ea, eb, prefix + git_tree_entry_name(eb), paths);
+  }
+
+  const size_t na = a ? git_tree_entrycount(a) : 0;
+  for (size_t i = 0; i < na; ++i)
+  {
+    const git_tree_entry* ea = git_tree_entry_byindex(a, i);
+    if (!b || !git_tree_entry_byname(b, git_tree_entry_name(ea)))
+    {
+      collect_entry(repo, ea, nullptr, prefix + git_tree_entry_name(ea), paths);
+    }
+  }
+}
+
+/// Paths of \p commit that differ from its first parent.
+bool collect_commit(git_repository* repo, const git_oid& id, std::unordered_set<std::string>& paths)
+{
+  git_commit* commit = nullptr;
+  if (git_commit_lookup(&commit, repo, &id) != 0)
+  {
+    return false;
+  }
+
+  git_tree* tree = nullptr;
+  git_commit* parent = nullptr;
+  git_tree* parent_tree = nullptr;
+  bool ok = git_commit_tree(&tree, commit) == 0;
+  if (ok && git_commit_parentcount(commit) > 0)
+  {
+    ok = git_commit_parent(&parent, commit, 0) == 0 && git_commit_tree(&parent_tree, parent) == 0;
+  }
+  if (ok)
+  {
+    collect_changed(repo, parent_tree, tree, std::string(), paths);
+  }
+  git_tree_free(parent_tree);
+  git_commit_free(parent);
+  git_tree_free(tree);
+  git_commit_free(commit);
+  return ok;
+}
+
+void print_log(std::ostream& ss, git_commit* commit)
 {
   char buf[GIT_OID_SHA1_HEX + 1];
   git_oid_tostr(buf, sizeof(buf), git_commit_id(commit));
@@ -125,7 +341,7 @@ void print_log(std::stringstream& ss, git_commit* commit)
   }
 }
 
-void print_log_oneline(std::stringstream& ss, git_commit* commit)
+void print_log_oneline(std::ostream& ss, git_commit* commit)
 {
   char buf[GIT_OID_SHA1_HEX_SHORT + 1];
   git_oid_tostr(buf, sizeof(buf), git_commit_id(commit));
@@ -135,7 +351,9 @@ void print_log_oneline(std::stringstream& ss, git_commit* commit)
   if (signature)
   {
     char date[11] = {0};
-    strftime(date, 11, "%Y-%m-%d", localtime(&signature->when.time));
+    struct tm tm;
+    time_t t = static_cast<time_t>(signature->when.time);
+    strftime(date, 11, "%Y-%m-%d", localtime_r(&t, &tm));
     ss << " <" << signature->email << "> " << date << " ";
   }
 
@@ -157,6 +375,199 @@ void print_log_oneline(std::stringstream& ss, git_commit* commit)
   ss << msg;
 }
 
+void log_error(std::ostream& ss, const char* what, int err)
+{
+  ss << what << " err = " << err << std::endl;
+  CROW_LOG_ERROR << what << " err = " << err;
+  const git_error* e = giterr_last();
+  if (e != nullptr)
+  {
+    CROW_LOG_ERROR << e->message;
+  }
+}
+
+/// Passes output on to \p target and keeps a copy of the first \p limit
+/// bytes, so a log can be cached while it is streamed.
+class CaptureBuf : public std::streambuf
+{
+public:
+  CaptureBuf(std::streambuf* target, size_t limit)
+    : m_target(target)
+    , m_limit(limit)
+    , m_complete(true)
+  {
+  }
+
+  /// False if the output did not fit.
+  bool captured(std::string& out)
+  {
+    if (!m_complete)
+    {
+      return false;
+    }
+    out.swap(m_copy);
+    return true;
+  }
+
+protected:
+  std::streamsize xsputn(const char* s, std::streamsize n) override
+  {
+    keep(s, n);
+    return m_target->sputn(s, n);
+  }
+
+  int_type overflow(int_type c) override
+  {
+    if (traits_type::eq_int_type(c, traits_type::eof()))
+    {
+      return traits_type::not_eof(c);
+    }
+    const char ch = traits_type::to_char_type(c);
+    keep(&ch, 1);
+    return m_target->sputc(ch);
+  }
+
+  int sync() override
+  {
+    return m_target->pubsync();
+  }
+
+private:
+  void keep(const char* s, std::streamsize n)
+  {
+    if (m_complete && m_copy.size() + n > m_limit)
+    {
+      m_complete = false;
+      std::string().swap(m_copy);
+    }
+    if (m_complete)
+    {
+      m_copy.append(s, n);
+    }
+  }
+
+private:
+  std::streambuf* m_target;
+  size_t m_limit;
+  bool m_complete;
+  std::string m_copy;
+};
+
+std::string blame_cache_key(const git_oid& head, const git_oid& blob, const std::string& file)
+{
+  char buf[2 * GIT_OID_SHA1_HEX];
+  git_oid_fmt(buf, &head);
+  git_oid_fmt(buf + GIT_OID_SHA1_HEX, &blob);
+  std::string key(buf, sizeof(buf));
+  key += file;
+  return key;
+}
+
+void print_blame_line(std::ostream& ss, const BlameHunk& hunk, uint32_t line, const char* text, size_t len)
+{
+  char oid[13] = {0};
+  char sig[65] = {0};
+  char date[11] = {0};
+  char out[128] = {0};
+  struct tm tm;
+  time_t t = static_cast<time_t>(hunk.time);
+  git_oid_tostr(oid, 13, &hunk.commit);
+  snprintf(sig, 65, "<%s>", hunk.email.c_str());
+  strftime(date, 11, "%Y-%m-%d", localtime_r(&t, &tm));
+  snprintf(out, 128, "%s (%-28s %-10s %3d) ", oid, sig, date, line);
+  ss << out;
+  ss.write(text, len);
+  ss << '\n';
+}
+
+std::string serialize_blame(const BlameResult& result)
+{
+  std::stringstream ss;
+  ss << "rest4git-blame 1 " << result.hunks.size() << "\n";
+  for (const auto& h : result.hunks)
+  {
+    char oid[GIT_OID_SHA1_HEX + 1] = {0};
+    git_oid_fmt(oid, &h.commit);
+    ss << h.start << " " << h.lines << " " << oid << " " << h.time << " " << h.email << "\n";
+  }
+  return ss.str();
+}
+
+BlameResultPtr deserialize_blame(const std::string& data, const git_oid& head, const git_oid& blob)
+{
+  std::istringstream is(data);
+  std::string magic;
+  int version = 0;
+  size_t count = 0;
+  if (!(is >> magic >> version >> count) || magic != "rest4git-blame" || version != 1)
+  {
+    return nullptr;
+  }
+
+  std::shared_ptr<BlameResult> result = std::make_shared<BlameResult>();
+  result->head = head;
+  result->blob = blob;
+  result->hunks.reserve(count);
+  for (size_t i = 0; i < count; ++i)
+  {
+    BlameHunk h;
+    std::string oid;
+    if (!(is >> h.start >> h.lines >> oid >> h.time) ||
+        git_oid_fromstr(&h.commit, oid.c_str()) != 0)
+    {
+      return nullptr;
+    }
+    is.get();
+    std::getline(is, h.email);
+    result->hunks.push_back(std::move(h));
+  }
+  return result;
+}
+
+std::string log_cache_key(const git_oid& head, uint32_t max, bool oneline, const std::string& file)
+{
+  char buf[GIT_OID_SHA1_HEX + 1] = {0};
+  git_oid_fmt(buf, &head);
+  std::string key(buf);
+  key += ":" + std::to_string(max) + (oneline ? ":1:" : ":0:") + file;
+  return key;
+}
+
+void print_redis_stats(std::stringstream& ss, const RedisCache& redis)
+{
+  if (!redis.enabled())
+  {
+    ss << std::left << std::setw(12) << "redis" << " disabled" << std::endl;
+    return;
+  }
+
+  const RedisStats stats = redis.stats();
+  ss << std::left << std::setw(12) << "redis"
+     << " hits " << stats.hits
+     << " misses " << stats.misses
+     << " timeouts " << stats.timeouts
+     << " errors " << stats.errors
+     << " stores " << stats.stores
+     << " endpoint " << redis.endpoint() << std::endl;
+}
+
+void print_cache_stats(std::stringstream& ss, const char* name, const CacheStats& stats)
+{
+  ss << std::left << std::setw(12) << name
+     << " hits " << stats.hits
+     << " misses " << stats.misses
+     << " insertions " << stats.insertions
+     << " evictions " << stats.evictions
+     << " entries " << stats.entries
+     << " weight " << stats.weight << "/" << stats.capacity << std::endl;
+}
+
+size_t env_size(const char* name, size_t fallback)
+{
+  const char* value = std::getenv(name);
+  return value != nullptr ? std::strtoul(value, nullptr, 10) : fallback;
+}
+
 Git2API& Git2API::get_instance()
 {
   static Git2API instance;
@@ -164,56 +575,70 @@ Git2API& Git2API::get_instance()
 }
 
 Git2API::Git2API()
-  : m_repo(nullptr, git_repository_free)
-  , m_ref(nullptr, git_reference_free)
+  : m_head_changes(0)
+  , m_carry_runs(0)
+  , m_carry_moved(0)
+  , m_carry_evicted(0)
+  , m_blame_cache(BLAME_CACHE_CAPACITY, CACHE_SHARDS)
+  , m_blame_base(BLAME_BASE_CAPACITY, CACHE_SHARDS)
+  , m_blame_full(0)
+  , m_blame_incremental(0)
+  , m_log_cache(LOG_CACHE_CAPACITY, CACHE_SHARDS)
+  , m_blob_cache(BLOB_CACHE_CAPACITY, CACHE_SHARDS)
 {
   git_libgit2_init();
-  git_repository* repo = nullptr;
-  int err = git_repository_open(&repo, rest4git::Utils::pwd().c_str());
+  const char* redis = std::getenv("REST4GIT_REDIS");
+  if (redis != nullptr)
+  {
+    m_redis.start(redis);
+  }
   CROW_LOG_INFO << "pwd: " << rest4git::Utils::pwd().c_str();
-  if (err != 0)
+  if (!m_pool.open(rest4git::Utils::pwd()))
   {
-    CROW_LOG_ERROR << "git_repository_open() err = " << err;
-    CROW_LOG_ERROR << giterr_last()->message;
     git_libgit2_shutdown();
   }
   else
   {
-    // Transfer ownership of repo and head
-    std::unique_ptr<git_repository, decltype(&git_repository_free)> unique_repo{std::move(repo), git_repository_free};
-    m_repo = std::move(unique_repo);
-
-    git_reference* ref = nullptr;
-    err = git_repository_head(&ref, m_repo.get());
-    CROW_LOG_INFO << "git_repository_head() err: " << err;
-    if (err == 0)
+    // Index file histories in the background, git_log walks meanwhile.
+    // REST4GIT_HISTORY=0 keeps walking, e.g. to compare the two.
+    if (env_size("REST4GIT_HISTORY", 1) != 0)
     {
-      std::unique_ptr<git_reference, decltype(&git_reference_free)> unique_ref{std::move(ref), git_reference_free};
-      m_ref = std::move(unique_ref);
-      m_current_branch_name = git_reference_shorthand(m_ref.get());
+      m_history.start(m_pool, std::string(git_repository_path(m_pool.main())) + "rest4git-history");
     }
-    else
+    refresh_head();
+
+    // Hot files are blamed again in the background after HEAD moved.
+    m_warmup.start([this](git_oid& head) { return head_id(head); },
+                   [this](const git_oid& head, const std::string& file) { warm_file(head, file); },
+                   env_size("REST4GIT_WARMUP_FILES", WARMUP_FILES),
+                   env_size("REST4GIT_WARMUP_CPU", WARMUP_CPU_PERCENT));
+
+    // A pull, commit or checkout in the served directory swaps the snapshot.
+    if (!m_watcher.start(git_repository_path(m_pool.main()), git_repository_commondir(m_pool.main()),
+                         [this] { refresh_head(); }))
     {
-      CROW_LOG_ERROR << "git_repository_head() err = " << err;
-      CROW_LOG_ERROR << giterr_last()->message;
+      CROW_LOG_ERROR << "reference watcher unavailable, HEAD is resolved per request";
     }
   }
 }
 
 Git2API::~Git2API()
 {
-  (void)m_ref.release();
-  (void)m_repo.release();
+  m_watcher.stop();
+  m_redis.stop();
+  m_warmup.stop();
+  m_history.stop();
+  m_pool.close();
   int err = git_libgit2_shutdown();
   CROW_LOG_INFO << "git_libgit2_shutdown() err: " << err;
 }
 
 bool Git2API::okay() const
 {
-  return m_repo != nullptr ? true : false;
+  return m_pool.okay();
 }
 
-bool Git2API::okay(std::stringstream &ss) const
+bool Git2API::okay(std::ostream& ss) const
 {
   if (!okay())
   {
@@ -224,9 +649,55 @@ bool Git2API::okay(std::stringstream &ss) const
   return true;
 }
 
-const std::string& Git2API::current_branch_name() const
+git_repository* Git2API::repository(std::ostream& ss)
+{
+  git_repository* repo = m_pool.get();
+  if (repo == nullptr)
+  {
+    ss << "Cannot open a repository handle" << std::endl;
+  }
+  return repo;
+}
+
+std::string Git2API::current_branch_name() const
+{
+  HeadStatePtr state = std::atomic_load(&m_head);
+  return state ? state->branch : std::string();
+}
+
+void Git2API::cache_stats(std::stringstream& ss) const
 {
-  return m_current_branch_name;
+  ss.clear();
+  print_cache_stats(ss, "blame", m_blame_cache.stats());
+  print_cache_stats(ss, "blame base", m_blame_base.stats());
+  ss << std::left << std::setw(12) << "blame runs"
+     << " full " << m_blame_full
+     << " incremental " << m_blame_incremental << std::endl;
+  print_cache_stats(ss, "blob lines", m_blob_cache.stats());
+  print_cache_stats(ss, "log", m_log_cache.stats());
+  ss << std::left << std::setw(12) << "carry over"
+     << " runs " << m_carry_runs
+     << " moved " << m_carry_moved
+     << " evicted " << m_carry_evicted << std::endl;
+  HistoryIndexPtr history = m_history.index();
+  ss << std::left << std::setw(12) << "history"
+     << " commits " << (history ? history->commits() : 0)
+     << " overlay " << (history ? history->overlay_commits() : 0)
+     << " paths " << (history ? history->paths() : 0)
+     << (m_history.busy() ? " updating" : " ready") << std::endl;
+  HeadStatePtr state = std::atomic_load(&m_head);
+  char oid[GIT_OID_SHA1_HEX_SHORT + 1] = {0};
+  if (state && state->born)
+  {
+    git_oid_tostr(oid, sizeof(oid), &state->oid);
+  }
+  ss << std::left << std::setw(12) << "head"
+     << " branch " << (state && !state->branch.empty() ? state->branch : "none")
+     << " commit " << (oid[0] ? oid : "none")
+     << " changes " << m_head_changes
+     << (m_watcher.running() ? " watched" : " unwatched") << std::endl;
+  m_warmup.print_stats(ss);
+  print_redis_stats(ss, m_redis);
 }
 
 void Git2API::git_status(std::stringstream &ss)
@@ -234,6 +705,7 @@ void Git2API::git_status(std::stringstream &ss)
   ss.clear();
   ss << "rest4git build: " << REST4GIT_BUILD_HASH << std::endl;
   ss << "pwd: " << rest4git::Utils::pwd().c_str() << std::endl;
+  ss << "repository handles: " << m_pool.size() << std::endl;
 
   if (!okay(ss))
   {
@@ -241,9 +713,10 @@ void Git2API::git_status(std::stringstream &ss)
   }
 
   // git status implementation
-  if (!m_current_branch_name.empty())
+  const std::string branch = current_branch_name();
+  if (!branch.empty())
   {
-    ss << "On branch " << m_current_branch_name << std::endl;
+    ss << "On branch " << branch << std::endl;
   }
   else
   {
@@ -254,8 +727,13 @@ void Git2API::git_status(std::stringstream &ss)
   git_status_options opts { GIT_STATUS_OPTIONS_VERSION, GIT_STATUS_SHOW_INDEX_ONLY };
   opts.flags = GIT_STATUS_OPT_DEFAULTS;
   git_status_list* status = NULL;
+  git_repository* repo = repository(ss);
+  if (repo == nullptr)
+  {
+    return;
+  }
 
-  int err = git_status_list_new(&status, m_repo.get(), &opts);
+  int err = git_status_list_new(&status, repo, &opts);
   CROW_LOG_INFO << "git_status_list_new() err: " << err;
   if (err == 0)
   {
@@ -294,7 +772,13 @@ void Git2API::git_branch(std::stringstream &ss, bool all)
     flags = { GIT_BRANCH_ALL };
   }
 
-  int err = git_branch_iterator_new(&iter, m_repo.get(), flags);
+  git_repository* repo = repository(ss);
+  if (repo == nullptr)
+  {
+    return;
+  }
+
+  int err = git_branch_iterator_new(&iter, repo, flags);
   CROW_LOG_INFO << "git_branch_iterator_new() err: " << err;
   if (err != 0)
   {
@@ -325,7 +809,7 @@ void Git2API::git_branch(std::stringstream &ss, bool all)
   git_branch_iterator_free(iter);
 }
 
-void Git2API::git_lf_files(std::stringstream& ss, const std::string& pattern)
+void Git2API::git_lf_files(std::stringstream& ss, const std::string& pattern, uint32_t limit)
 {
   ss.clear();
 
@@ -334,211 +818,802 @@ void Git2API::git_lf_files(std::stringstream& ss, const std::string& pattern)
     return;
   }
 
-  git_index* index = NULL;
-  int err = git_repository_index(&index, m_repo.get());
-  CROW_LOG_INFO << "git_repository_index() err: " << err;
+  git_repository* repo = repository(ss);
+  if (repo == nullptr)
+  {
+    return;
+  }
+  git_oid head;
+  int err = resolve_head(head);
+  CROW_LOG_INFO << "resolve_head() err: " << err;
   if (err != 0)
   {
-    ss << "git_repository_index() err = " << err << std::endl;
-    CROW_LOG_ERROR << "git_repository_index() err = " << err;
-    CROW_LOG_ERROR << giterr_last()->message;
+    log_error(ss, "resolve_head()", err);
+    return;
+  }
 
+  TrigramIndexPtr index = trigram_index(repo, head);
+  if (!index)
+  {
+    ss << "Cannot index the files of HEAD" << std::endl;
     return;
   }
 
-  const size_t count = git_index_entrycount(index);
-  #pragma omp parallel for
-  for (size_t i = 0; i < count; ++i) 
+  // Newline after every path but the last one of the tree, as before.
+  const uint32_t last = index->size() - 1;
+  uint32_t count = 0;
+  index->search(pattern, [&](uint32_t id)
   {
-    const git_index_entry* entry = git_index_get_byindex(index, i);
-    if (pattern.empty())
-    {
-      ss << entry->path;
-      if (i < count - 1)
-      {
-        ss << std::endl;
-      }
-    }
-    else
+    size_t len = 0;
+    const char* path = index->path(id, len);
+    ss.write(path, len);
+    if (id < last)
     {
-      std::string path(entry->path);
-      if (rest4git::Utils::find(path, pattern) != std::string::npos)
-      {
-        ss << entry->path;
-        if (i < count - 1)
-        {
-          ss << std::endl;
-        }
-      }
+      ss << '\n';
     }
-  }
-  git_index_free(index);
+    return limit == 0 || ++count < limit;
+  });
 }
 
-void Git2API::git_blame(std::stringstream &ss, const std::string& file, uint32_t from, uint32_t to)
+BlameResultPtr Git2API::blame_file(std::ostream& ss, git_repository* repo, const git_oid& head,
+  const git_oid& blob, const std::string& file)
 {
-  ss.clear();
-
-  if (!okay(ss))
+  const std::string key = blame_cache_key(head, blob, file);
+  BlameResultPtr cached;
+  if (m_blame_cache.get(key, cached))
   {
-    return;
+    return cached;
   }
 
-  struct git_blame* blame = nullptr;
-  git_blame_options blameopts = GIT_BLAME_OPTIONS_INIT;
-  blameopts.min_line = from;
-  blameopts.max_line = to;
-
-  int err = git_blame_file(&blame, m_repo.get(), file.c_str(), &blameopts);
-  CROW_LOG_INFO << "git_blame_file() err: " << err;
-  if (err != 0)
+  // Second tier, shared with other instances on the same mirror.
+  const std::string redis_key = "rest4git:blame:" + key;
+  std::string remote;
+  if (m_redis.get(redis_key, remote))
   {
-    ss << "git_blame_file() err = " << err << std::endl;
-    CROW_LOG_ERROR << "git_blame_file() err = " << err;
-    CROW_LOG_ERROR << giterr_last()->message;
-
-    return;
+    cached = deserialize_blame(remote, head, blob);
+    if (cached)
+    {
+      m_blame_cache.put(key, cached, cached->weight());
+      return cached;
+    }
   }
 
-  std::string spec("HEAD");
-  if (!file.empty())
+  // Only the commits since the previous blame of this path are walked.
+  std::shared_ptr<BlameResult> result;
+  BlameResultPtr base;
+  if (m_blame_base.get(file, base) && !git_oid_equal(&base->head, &head))
   {
-    spec += ":";
-    spec += file;
+    result = blame_incremental(repo, *base, head, blob, file);
   }
 
-  git_object *obj = nullptr;
-  err = git_revparse_single(&obj, m_repo.get(), spec.c_str());
-  CROW_LOG_INFO << "git_revparse_single() err: " << err;
-  if (err != 0)
+  if (result)
   {
-    ss << "git_revparse_single() err = " << err << std::endl;
-    CROW_LOG_ERROR << "git_revparse_single() err = " << err;
-    CROW_LOG_ERROR << giterr_last()->message;
-    git_blame_free(blame);
-
-    return;
+    m_blame_incremental++;
   }
-
-  git_blob *blob = nullptr;
-  err = git_blob_lookup(&blob, m_repo.get(), git_object_id(obj));
-  CROW_LOG_INFO << "git_blob_lookup() err: " << err;
-  if (err != 0)
+  else
   {
-    ss << "git_blob_lookup() err = " << err << std::endl;
-    CROW_LOG_ERROR << "git_blob_lookup() err = " << err;
-    CROW_LOG_ERROR << giterr_last()->message;
-    git_object_free(obj);
-    git_blame_free(blame);
-
-    return;
-  }
+    struct git_blame* blame = nullptr;
+    git_blame_options blameopts = GIT_BLAME_OPTIONS_INIT;
+    blameopts.newest_commit = head;
 
-  git_object_free(obj);
+    int err = git_blame_file(&blame, repo, file.c_str(), &blameopts);
+    CROW_LOG_INFO << "git_blame_file() err: " << err;
+    if (err != 0)
+    {
+      log_error(ss, "git_blame_file()", err);
+      return nullptr;
+    }
 
-  const char* rawdata = static_cast<const char*>(git_blob_rawcontent(blob));
-  const int64_t rawsize = git_blob_rawsize(blob);
+    result = std::make_shared<BlameResult>();
+    result->head = head;
+    result->blob = blob;
 
-  uint32_t line = 1;
-  uint32_t i = line - 1;
-  while (i < rawsize)
-  {
-    const char *eol = static_cast<const char*>(memchr(rawdata + i, '\n', (size_t)(rawsize - i)));
-    const git_blame_hunk* hunk = git_blame_get_hunk_byline(blame, line);
-    if (hunk)
+    const uint32_t count = git_blame_get_hunk_count(blame);
+    result->hunks.reserve(count);
+    for (uint32_t i = 0; i < count; ++i)
     {
-      char oid[13] = {0};
-      char sig[65] = {0};
-      char date[11] = {0};
-      char out[1024] = {0};
-      git_oid_tostr(oid, 13, &hunk->final_commit_id);
-      snprintf(sig, 65, "<%s>", hunk->final_signature->email);
-      strftime(date, 11, "%Y-%m-%d", localtime(&hunk->final_signature->when.time));
-      snprintf(out, 1024,
-"%s (%-28s %-10s %3d) %.*s\n",
-        oid,
-        sig, 
-        date, 
-        line, 
-        (int)(eol - rawdata - i), 
-        rawdata + i);
-      ss << out;
-    }
-    i = (int)(eol - rawdata + 1);
-    line++;
-  }
-  
+      const git_blame_hunk* hunk = git_blame_get_hunk_byindex(blame, i);
+      result->append(static_cast<uint32_t>(hunk->final_start_line_number),
+                     static_cast<uint32_t>(hunk->lines_in_hunk),
+                     hunk->final_commit_id,
+                     hunk->final_signature ? hunk->final_signature->when.time : 0,
+                     (hunk->final_signature && hunk->final_signature->email) ?
+                       hunk->final_signature->email : "");
+    }
+    git_blame_free(blame);
+    m_blame_full++;
+  }
 
-  git_blob_free(blob);
-  git_blame_free(blame);
+  m_blame_cache.put(key, result, result->weight());
+  m_blame_base.put(file, result, result->weight());
+  m_redis.set_async(redis_key, serialize_blame(*result));
+  return result;
 }
 
-void Git2API::git_show(std::stringstream &ss, const std::string &file, uint32_t from, uint32_t to)
+std::shared_ptr<BlameResult> Git2API::blame_incremental(git_repository* repo, const BlameResult& base,
+  const git_oid& head, const git_oid& blob, const std::string& file)
 {
-  ss.clear();
-
-  if (!okay(ss))
+  // HEAD must have moved forward, otherwise the base says nothing about it.
+  if (git_graph_descendant_of(repo, &head, &base.head) != 1)
   {
-    return;
+    return nullptr;
   }
 
-  std::string spec("HEAD:");
-  spec += file;
+  // Lines not changed since base.head come back attributed to base.head,
+  // their origin line numbers then index into the base blame.
+  struct git_blame* blame = nullptr;
+  git_blame_options blameopts = GIT_BLAME_OPTIONS_INIT;
+  blameopts.newest_commit = head;
+  blameopts.oldest_commit = base.head;
 
-  git_object *obj = nullptr;
-  git_blob *blob = nullptr;
-  int err = git_revparse_single(&obj, m_repo.get(), spec.c_str());
-  CROW_LOG_INFO << "git_revparse_single() err: " << err;
+  int err = git_blame_file(&blame, repo, file.c_str(), &blameopts);
+  CROW_LOG_INFO << "git_blame_file() incremental err: " << err;
   if (err != 0)
   {
-    ss << "git_revparse_single() err = " << err << std::endl;
-    CROW_LOG_ERROR << "git_revparse_single() err = " << err;
-    CROW_LOG_ERROR << giterr_last()->message;
-
-    return;
+    CROW_LOG_ERROR << "git_blame_file() incremental err = " << err;
+    return nullptr;
   }
 
-  err = git_blob_lookup(&blob, m_repo.get(), git_object_id(obj));
-  CROW_LOG_INFO << "git_blob_lookup() err: " << err;
-  if (err != 0)
+  std::shared_ptr<BlameResult> result = std::make_shared<BlameResult>();
+  result->head = head;
+  result->blob = blob;
+
+  bool remapped = true;
+  const uint32_t count = git_blame_get_hunk_count(blame);
+  for (uint32_t i = 0; i < count && remapped; ++i)
   {
-    ss << "git_blob_lookup() err = " << err << std::endl;
-    CROW_LOG_ERROR << "git_blob_lookup() err = " << err;
-    CROW_LOG_ERROR << giterr_last()->message;
-    git_object_free(obj);
+    const git_blame_hunk* hunk = git_blame_get_hunk_byindex(blame, i);
+    const uint32_t start = static_cast<uint32_t>(hunk->final_start_line_number);
+    const uint32_t lines = static_cast<uint32_t>(hunk->lines_in_hunk);
+    if (!git_oid_equal(&hunk->final_commit_id, &base.head))
+    {
+      result->append(start, lines, hunk->final_commit_id,
+                     hunk->final_signature ? hunk->final_signature->when.time : 0,
+                     (hunk->final_signature && hunk->final_signature->email) ?
+                       hunk->final_signature->email : "");
+      continue;
+    }
+
+    const uint32_t orig = static_cast<uint32_t>(hunk->orig_start_line_number);
+    for (uint32_t k = 0; k < lines; ++k)
+    {
+      const BlameHunk* old = base.hunk_byline(orig + k);
+      if (old == nullptr)
+      {
+        remapped = false;
+        break;
+      }
+      result->append(start + k, 1, old->commit, old->time, old->email);
+    }
+  }
+  git_blame_free(blame);
+
+  if (!remapped)
+  {
+    CROW_LOG_ERROR << "incremental blame of " << file << " could not be remapped";
+    return nullptr;
+  }
+
+  return result;
+}
+
+PathIndexPtr Git2API::path_index(git_repository* repo, const git_oid& head)
+{
+  PathIndexPtr index = std::atomic_load(&m_paths);
+  if (index && git_oid_equal(&index->head(), &head))
+  {
+    return index;
+  }
+
+  // One thread rebuilds after HEAD moved, the others wait for its result.
+  std::lock_guard<std::mutex> lock(m_paths_mutex);
+  index = std::atomic_load(&m_paths);
+  if (index && git_oid_equal(&index->head(), &head))
+  {
+    return index;
+  }
+
+  index = PathIndex::build(repo, head);
+  if (!index)
+  {
+    CROW_LOG_ERROR << "PathIndex::build() failed";
+    return nullptr;
+  }
+  CROW_LOG_INFO << "path index rebuilt: " << index->size() << " files";
+  std::atomic_store(&m_paths, index);
+  m_warmup.request();
+  return index;
+}
+
+TrigramIndexPtr Git2API::trigram_index(git_repository* repo, const git_oid& head)
+{
+  TrigramIndexPtr index = std::atomic_load(&m_trigrams);
+  if (index && git_oid_equal(&index->head(), &head))
+  {
+    return index;
+  }
+  if (!index)
+  {
+    // First use, there is nothing to serve until it is built.
+    std::lock_guard<std::mutex> lock(m_trigrams_mutex);
+    return build_trigrams(repo, head);
+  }
+
+  // After HEAD moved the previous snapshot is served while refresh_head()
+  // builds the next one on the watcher thread. Without the watcher one
+  // request builds it and the others do not wait for it.
+  std::unique_lock<std::mutex> lock(m_trigrams_mutex, std::try_to_lock);
+  if (m_watcher.running() || !lock.owns_lock())
+  {
+    return index;
+  }
+  return build_trigrams(repo, head);
+}
+
+TrigramIndexPtr Git2API::build_trigrams(git_repository* repo, const git_oid& head)
+{
+  TrigramIndexPtr index = std::atomic_load(&m_trigrams);
+  if (index && git_oid_equal(&index->head(), &head))
+  {
+    return index;
+  }
+
+  PathIndexPtr paths = path_index(repo, head);
+  if (!paths)
+  {
+    return nullptr;
+  }
+  index = TrigramIndex::build(*paths);
+  CROW_LOG_INFO << "trigram index rebuilt: " << index->size() << " files, " << index->weight() << " bytes";
+  std::atomic_store(&m_trigrams, index);
+  return index;
+}
+
+bool Git2API::blob_id(std::ostream& ss, git_repository* repo, const git_oid& head,
+  const std::string& file, git_oid& blob)
+{
+  PathIndexPtr index = path_index(repo, head);
+  PathEntry entry;
+  if (!index || !index->find(file, entry))
+  {
+    ss << "File " << file << " not found!" << std::endl;
+    return false;
+  }
+
+  blob = entry.oid;
+  return true;
+}
+
+void Git2API::warm_file(const git_oid& head, const std::string& file)
+{
+  std::stringstream ss;
+  git_repository* repo = repository(ss);
+  git_oid id;
+  if (repo != nullptr && blob_id(ss, repo, head, file, id) && blame_file(ss, repo, head, id, file))
+  {
+    blob_lines(ss, repo, id);
+  }
+}
+
+bool Git2API::carry_over(git_repository* repo, const git_oid& from, const git_oid& to)
+{
+  // Results of an unrelated HEAD (reset, rebase) say nothing about the new one.
+  if (git_graph_descendant_of(repo, &to, &from) != 1)
+  {
+    return false;
+  }
+
+  // Every path a new commit changed against its first parent, this covers
+  // the tree diff and files changed and reverted on the way.
+  std::unordered_set<std::string> changed;
+  git_revwalk* walker = nullptr;
+  if (git_revwalk_new(&walker, repo) != 0)
+  {
+    return false;
+  }
+  bool ok = git_revwalk_push(walker, &to) == 0 && git_revwalk_hide(walker, &from) == 0;
+  uint32_t commits = 0;
+  git_oid id;
+  while (ok && git_revwalk_next(&id, walker) == 0)
+  {
+    ok = ++commits <= CARRY_OVER_MAX_COMMITS && collect_commit(repo, id, changed);
+  }
+  git_revwalk_free(walker);
+  if (!ok)
+  {
+    CROW_LOG_ERROR << "carry over: changed paths not collected, " << commits << " commits";
+    return false;
+  }
+
+  char old_hex[GIT_OID_SHA1_HEX];
+  char new_hex[GIT_OID_SHA1_HEX];
+  git_oid_fmt(old_hex, &from);
+  git_oid_fmt(new_hex, &to);
+  uint64_t evicted = 0;
+
+  // Blame keys are head, blob and path.
+  size_t moved = m_blame_cache.rekey([&](const std::string& key, std::string& next)
+  {
+    if (key.compare(0, GIT_OID_SHA1_HEX, old_hex, GIT_OID_SHA1_HEX) != 0)
+    {
+      return CacheAction::Keep;
+    }
+    if (changed.count(key.substr(2 * GIT_OID_SHA1_HEX)) > 0)
+    {
+      evicted++;
+      return CacheAction::Evict;
+    }
+    next = key;
+    next.replace(0, GIT_OID_SHA1_HEX, new_hex, GIT_OID_SHA1_HEX);
+    return CacheAction::Move;
+  });
+
+  // A log of a directory changes with any file below it.
+  std::unordered_set<std::string> changed_dirs;
+  for (const auto& path : changed)
+  {
+    for (std::string::size_type slash = path.find('/'); slash != std::string::npos; slash = path.find('/', slash + 1))
+    {
+      changed_dirs.insert(path.substr(0, slash));
+    }
+  }
+
+  // Log keys are head:max:oneline:path, logs of everything always change.
+  moved += m_log_cache.rekey([&](const std::string& key, std::string& next)
+  {
+    if (key.compare(0, GIT_OID_SHA1_HEX, old_hex, GIT_OID_SHA1_HEX) != 0)
+    {
+      return CacheAction::Keep;
+    }
+    const std::string::size_type colon = key.find(':', key.find(':', GIT_OID_SHA1_HEX + 1) + 1);
+    const std::vector<std::string> parts = split_path(key.substr(colon + 1));
+    std::string path;
+    for (const auto& part : parts)
+    {
+      path += (path.empty() ? "" : "/") + part;
+    }
+    if (parts.empty() || changed.count(path) > 0 || changed_dirs.count(path) > 0)
+    {
+      evicted++;
+      return CacheAction::Evict;
+    }
+    next = key;
+    next.replace(0, GIT_OID_SHA1_HEX, new_hex, GIT_OID_SHA1_HEX);
+    return CacheAction::Move;
+  });
+
+  m_carry_runs++;
+  m_carry_moved += moved;
+  m_carry_evicted += evicted;
+  CROW_LOG_WARNING << "carry over: " << commits << " commits, " << changed.size() << " changed paths, "
+                   << moved << " entries moved, " << evicted << " evicted";
+  return true;
+}
+
+bool Git2API::etag(const std::string& file, uint32_t from, uint32_t to, bool blame, std::string& tag)
+{
+  git_oid head;
+  if (!head_id(head))
+  {
+    return false;
+  }
+
+  PathIndexPtr index = std::atomic_load(&m_paths);
+  PathEntry entry;
+  if (!index || !git_oid_equal(&index->head(), &head) || !index->find(file, entry))
+  {
+    return false;
+  }
+
+  // A show depends on the blob only, a blame also on the history of HEAD.
+  char hex[GIT_OID_SHA1_HEX + 1] = {0};
+  tag = blame ? "\"b-" : "\"s-";
+  if (blame)
+  {
+    git_oid_fmt(hex, &head);
+    tag += hex;
+    tag += '-';
+  }
+  git_oid_fmt(hex, &entry.oid);
+  tag += hex;
+  tag += '-' + std::to_string(from) + '-' + std::to_string(to) + '"';
+  return true;
+}
+
+bool Git2API::head_id(git_oid& head)
+{
+  return okay() && resolve_head(head) == 0;
+}
+
+int Git2API::resolve_head(git_oid& head)
+{
+  // The watcher keeps the snapshot current, without it HEAD is read per call.
+  HeadStatePtr state = std::atomic_load(&m_head);
+  if (!state || !m_watcher.running())
+  {
+    git_repository* repo = m_pool.get();
+    return repo != nullptr ? git_reference_name_to_id(&head, repo, "HEAD") : GIT_ERROR;
+  }
+  if (!state->born)
+  {
+    return GIT_EUNBORNBRANCH;
+  }
+  head = state->oid;
+  return 0;
+}
+
+void Git2API::refresh_head()
+{
+  std::shared_ptr<HeadState> state = std::make_shared<HeadState>();
+  state->born = false;
+  git_repository* repo = m_pool.get();
+  if (repo == nullptr)
+  {
+    CROW_LOG_ERROR << "refresh_head(): no repository handle";
+    return;
+  }
+  git_reference* ref = nullptr;
+  int err = git_repository_head(&ref, repo);
+  CROW_LOG_INFO << "git_repository_head() err: " << err;
+  if (err == 0)
+  {
+    state->born = true;
+    git_oid_cpy(&state->oid, git_reference_target(ref));
+    state->branch = git_reference_shorthand(ref);
+    git_reference_free(ref);
+  }
+  else if (err != GIT_EUNBORNBRANCH)
+  {
+    // E.g. caught in the middle of a ref update, keep the last snapshot.
+    CROW_LOG_ERROR << "git_repository_head() err = " << err;
+    return;
+  }
+
+  // Only the watcher thread refreshes, after the constructor did once.
+  HeadStatePtr old = std::atomic_load(&m_head);
+  const bool moved = state->born && (!old || !old->born || !git_oid_equal(&old->oid, &state->oid));
+  if (old && !moved && old->born == state->born && old->branch == state->branch)
+  {
+    return;
+  }
+
+  // Cached results of untouched files move to the new HEAD before requests
+  // see it, so they keep hitting.
+  if (moved && old && old->born)
+  {
+    carry_over(repo, old->oid, state->oid);
+  }
+  std::atomic_store(&m_head, HeadStatePtr(state));
+  if (!old)
+  {
+    if (state->born)
+    {
+      m_history.request(state->oid);
+    }
+    return;
+  }
+
+  char oid[GIT_OID_SHA1_HEX_SHORT + 1] = {0};
+  if (state->born)
+  {
+    git_oid_tostr(oid, sizeof(oid), &state->oid);
+  }
+  CROW_LOG_WARNING << "HEAD changed: " << state->branch << " " << oid;
+  m_head_changes++;
+  if (!moved)
+  {
+    return;
+  }
+
+  // Requests in flight finish on their own HEAD.
+  // The indexes of the new HEAD are built here instead of in the next
+  // request, which also starts the blame warmup.
+  m_history.request(state->oid);
+  path_index(repo, state->oid);
+  if (std::atomic_load(&m_trigrams))
+  {
+    std::lock_guard<std::mutex> lock(m_trigrams_mutex);
+    build_trigrams(repo, state->oid);
+  }
+}
+
+bool Git2API::file_exists(const std::string& file)
+{
+  git_oid head;
+  if (!head_id(head))
+  {
+    return false;
+  }
+
+  git_repository* repo = m_pool.get();
+  if (repo == nullptr)
+  {
+    return false;
+  }
+  PathIndexPtr index = path_index(repo, head);
+  return index && index->contains(file);
+}
+
+BlobLinesPtr Git2API::blob_lines(std::ostream& ss, git_repository* repo, const git_oid& id)
+{
+  const std::string key(reinterpret_cast<const char*>(id.id), sizeof(id.id));
+  BlobLinesPtr cached;
+  if (m_blob_cache.get(key, cached))
+  {
+    return cached;
+  }
+
+  git_blob* blob = nullptr;
+  int err = git_blob_lookup(&blob, repo, &id);
+  CROW_LOG_INFO << "git_blob_lookup() err: " << err;
+  if (err != 0)
+  {
+    log_error(ss, "git_blob_lookup()", err);
+    return nullptr;
+  }
+
+  cached = BlobLines::build(static_cast<const char*>(git_blob_rawcontent(blob)),
+                            static_cast<size_t>(git_blob_rawsize(blob)));
+  git_blob_free(blob);
+  if (!cached)
+  {
+    ss << "Blob is too large" << std::endl;
+    return nullptr;
+  }
+
+  m_blob_cache.put(key, cached, cached->weight());
+  return cached;
+}
+
+void Git2API::git_blame(std::ostream& ss, const std::string& file, uint32_t from, uint32_t to)
+{
+  ss.clear();
+
+  if (!okay(ss))
+  {
+    return;
+  }
 
+  git_repository* repo = repository(ss);
+  if (repo == nullptr)
+  {
+    return;
+  }
+  git_oid head;
+  int err = resolve_head(head);
+  CROW_LOG_INFO << "resolve_head() err: " << err;
+  if (err != 0)
+  {
+    log_error(ss, "resolve_head()", err);
     return;
   }
 
-  git_object_free(obj);
-  const char* rawdata = static_cast<const char*>(git_blob_rawcontent(blob));
+  git_oid id;
+  if (!blob_id(ss, repo, head, file, id))
+  {
+    return;
+  }
+  m_warmup.record(file);
+
+  // Line ranges are sliced out of the cached whole-file blame.
+  BlameResultPtr result = blame_file(ss, repo, head, id, file);
+  if (!result)
+  {
+    return;
+  }
+
+  BlobLinesPtr blob = blob_lines(ss, repo, id);
+  if (!blob)
+  {
+    return;
+  }
+
+  const uint32_t last = (to == 0) ? blob->lines() : std::min(to, blob->lines());
+  for (uint32_t line = std::max(from, 1U); line <= last && ss; ++line)
+  {
+    const BlameHunk* hunk = result->hunk_byline(line);
+    const char* text = nullptr;
+    size_t len = 0;
+    if (hunk && blob->line(line, text, len))
+    {
+      print_blame_line(ss, *hunk, line, text, len);
+    }
+  }
+}
+
+void Git2API::git_show(std::stringstream &ss, const std::string &file, uint32_t from, uint32_t to)
+{
+  ss.clear();
+
+  if (!okay(ss))
+  {
+    return;
+  }
+
+  git_repository* repo = repository(ss);
+  if (repo == nullptr)
+  {
+    return;
+  }
+  git_oid head;
+  int err = resolve_head(head);
+  CROW_LOG_INFO << "resolve_head() err: " << err;
+  if (err != 0)
+  {
+    log_error(ss, "resolve_head()", err);
+    return;
+  }
+
+  git_oid id;
+  if (!blob_id(ss, repo, head, file, id))
+  {
+    return;
+  }
+  m_warmup.record(file);
+
+  BlobLinesPtr blob = blob_lines(ss, repo, id);
+  if (!blob)
+  {
+    return;
+  }
 
   if (from == 1 && to == 0)
   {
-    ss << rawdata;
+    ss.write(blob->data().data(), blob->data().size());
+    return;
   }
-  else
+
+  const uint32_t last = (to == 0) ? blob->lines() : std::min(to, blob->lines());
+  for (uint32_t line = std::max(from, 1U); line <= last; ++line)
+  {
+    const char* text = nullptr;
+    size_t len = 0;
+    if (blob->line(line, text, len))
+    {
+      ss.write(text, len);
+      ss << '\n';
+    }
+  }
+}
+
+void Git2API::git_blame_trace(std::stringstream& ss, const std::vector<TraceFrame>& frames, uint32_t context)
+{
+  ss.clear();
+
+  if (!okay(ss))
+  {
+    return;
+  }
+
+  git_repository* repo = repository(ss);
+  if (repo == nullptr)
+  {
+    return;
+  }
+  git_oid head;
+  int err = resolve_head(head);
+  CROW_LOG_INFO << "resolve_head() err: " << err;
+  if (err != 0)
+  {
+    log_error(ss, "resolve_head()", err);
+    return;
+  }
+
+  PathIndexPtr paths = path_index(repo, head);
+  if (!paths)
+  {
+    ss << "Cannot index the files of HEAD" << std::endl;
+    return;
+  }
+
+  // Resolve all frames first, so every file is blamed once.
+  std::vector<std::vector<std::string>> resolved(frames.size());
+  std::vector<std::string> files;
+  std::unordered_map<std::string, size_t> file_ids;
+  for (size_t f = 0; f < frames.size(); ++f)
+  {
+    paths->resolve(frames[f].path, resolved[f]);
+    if (resolved[f].size() == 1 && file_ids.emplace(resolved[f][0], files.size()).second)
+    {
+      files.push_back(resolved[f][0]);
+      m_warmup.record(resolved[f][0]);
+    }
+  }
+
+  struct FileBlame
+  {
+    BlameResultPtr blame;
+    BlobLinesPtr lines;
+    std::string error;
+  };
+  std::vector<FileBlame> blames(files.size());
+  const long count = static_cast<long>(files.size());
+  #pragma omp parallel for schedule(dynamic)
+  for (long i = 0; i < count; ++i)
   {
-    const int64_t rawsize = git_blob_rawsize(blob);
-    uint32_t line = 1;
-    uint32_t i = line - 1;
-    while (i < rawsize)
+    std::stringstream error;
+    git_repository* thread_repo = repository(error);
+    if (thread_repo == nullptr)
     {
-      const char *eol = static_cast<const char*>(memchr(rawdata + i, '\n', (size_t)(rawsize - i)));
-      if (line >= from && line <= to)
+      blames[i].error = error.str();
+      continue;
+    }
+    PathEntry entry;
+    paths->find(files[i], entry);
+    blames[i].blame = blame_file(error, thread_repo, head, entry.oid, files[i]);
+    if (blames[i].blame)
+    {
+      blames[i].lines = blob_lines(error, thread_repo, entry.oid);
+    }
+    if (!blames[i].blame || !blames[i].lines)
+    {
+      blames[i].error = error.str();
+    }
+  }
+
+  char oid[GIT_OID_SHA1_HEX + 1];
+  git_oid_tostr(oid, sizeof(oid), &head);
+  crow::json::wvalue out;
+  out["head"] = oid;
+  out["frames"] = std::vector<crow::json::wvalue>();
+  for (size_t f = 0; f < frames.size(); ++f)
+  {
+    crow::json::wvalue& frame = out["frames"][f];
+    frame["path"] = frames[f].path;
+    frame["line"] = frames[f].line;
+    if (resolved[f].empty())
+    {
+      frame["error"] = "File not found";
+      continue;
+    }
+    if (resolved[f].size() > 1)
+    {
+      frame["error"] = "Ambiguous file name";
+      frame["candidates"] = resolved[f];
+      continue;
+    }
+
+    const FileBlame& fb = blames[file_ids[resolved[f][0]]];
+    frame["file"] = resolved[f][0];
+    if (!fb.error.empty())
+    {
+      frame["error"] = fb.error;
+      continue;
+    }
+
+    const uint32_t line = frames[f].line;
+    const uint32_t from = (line > context) ? line - context : 1;
+    const uint32_t to = std::min(line + context, fb.lines->lines());
+    frame["blame"] = std::vector<crow::json::wvalue>();
+    uint32_t n = 0;
+    for (uint32_t l = from; l <= to; ++l)
+    {
+      const BlameHunk* hunk = fb.blame->hunk_byline(l);
+      const char* text = nullptr;
+      size_t len = 0;
+      if (!hunk || !fb.lines->line(l, text, len))
       {
-        char out[1024] = {0};
-        snprintf(out, 1024, "%.*s\n", (int)(eol - rawdata - i), rawdata + i);
-        ss << out;
+        continue;
       }
-      i = (int)(eol - rawdata + 1);
-      line++;
+
+      char date[11] = {0};
+      struct tm tm;
+      time_t t = static_cast<time_t>(hunk->time);
+      strftime(date, sizeof(date), "%Y-%m-%d", localtime_r(&t, &tm));
+      git_oid_tostr(oid, sizeof(oid), &hunk->commit);
+
+      crow::json::wvalue& entry = frame["blame"][n++];
+      entry["line"] = l;
+      entry["commit"] = oid;
+      entry["author"] = hunk->email;
+      entry["date"] = date;
+      entry["text"] = std::string(text, len);
     }
   }
-  git_blob_free(blob);
+  ss << crow::json::dump(out);
 }
 
-void Git2API::git_log(std::stringstream &ss, uint32_t max, bool oneline, const std::string& file)
+void Git2API::git_log(std::ostream& ss, uint32_t max, bool oneline, const std::string& file)
 {
   ss.clear();
 
@@ -547,33 +1622,157 @@ void Git2API::git_log(std::stringstream &ss, uint32_t max, bool oneline, const s
     return;
   }
 
+  git_repository* repo = repository(ss);
+  if (repo == nullptr)
+  {
+    return;
+  }
+  git_oid head;
+  int err = resolve_head(head);
+  CROW_LOG_INFO << "resolve_head() err: " << err;
+  if (err == GIT_EUNBORNBRANCH)
+  {
+    ss << "Not currently on any branch." << std::endl;
+    return;
+  }
+  if (err != 0)
+  {
+    log_error(ss, "resolve_head()", err);
+    return;
+  }
+
+  const std::string key = log_cache_key(head, max, oneline, file);
+  std::shared_ptr<const std::string> cached;
+  if (m_log_cache.get(key, cached))
+  {
+    ss << *cached;
+    return;
+  }
+
+  const std::string redis_key = "rest4git:log:" + key;
+  std::string remote;
+  if (m_redis.get(redis_key, remote))
+  {
+    cached = std::make_shared<const std::string>(std::move(remote));
+    m_log_cache.put(key, cached, cached->size() + key.size());
+    ss << *cached;
+    return;
+  }
+
+  // Written to ss as it is produced, a copy is cached unless it outgrows
+  // a cache shard or the client went away.
+  CaptureBuf capture(ss.rdbuf(), LOG_CACHE_CAPACITY / CACHE_SHARDS);
+  std::ostream out(&capture);
+  if (file.empty() || !log_indexed(out, repo, head, max, oneline, file))
+  {
+    if (!log_walk(out, repo, head, max, oneline, file))
+    {
+      return;
+    }
+  }
+
+  std::string copy;
+  if (!out || !capture.captured(copy))
+  {
+    return;
+  }
+  cached = std::make_shared<const std::string>(std::move(copy));
+  m_log_cache.put(key, cached, cached->size() + key.size());
+  m_redis.set_async(redis_key, *cached);
+}
+
+bool Git2API::log_indexed(std::ostream& ss, git_repository* repo, const git_oid& head,
+  uint32_t max, bool oneline, const std::string& file)
+{
+  HistoryIndexPtr index = m_history.index();
+  if (!index || index->commits() == 0 || !git_oid_equal(&index->head(), &head))
+  {
+    m_history.request(head);
+    return false;
+  }
+
+  std::vector<uint32_t> ordinals;
+  if (!index->lookup(file, ordinals))
+  {
+    // A file of HEAD that no first-parent commit touched has no history,
+    // anything else (directories, wildcards) needs the revwalk.
+    PathIndexPtr paths = path_index(repo, head);
+    return paths && paths->contains(file);
+  }
+
+  uint32_t count = 0;
+  bool written = false;
+  for (auto it = ordinals.rbegin(); it != ordinals.rend() && ss; ++it)
+  {
+    // Same output as log_walk, including its separators.
+    if (max != 0 && count++ >= max)
+    {
+      break;
+    }
+    else if (count > 1)
+    {
+      ss << std::endl;
+    }
+
+    git_commit* commit = nullptr;
+    int err = git_commit_lookup(&commit, repo, &index->commit(*it));
+    if (err != 0)
+    {
+      // Output already sent cannot be replaced by the walk.
+      if (!written)
+      {
+        CROW_LOG_ERROR << "git_commit_lookup() err = " << err;
+        return false;
+      }
+      log_error(ss, "git_commit_lookup()", err);
+      return true;
+    }
+    if (oneline)
+    {
+      print_log_oneline(ss, commit);
+    }
+    else
+    {
+      print_log(ss, commit);
+    }
+    written = true;
+    git_commit_free(commit);
+  }
+  return true;
+}
+
+bool Git2API::log_walk(std::ostream& ss, git_repository* repo, const git_oid& head,
+  uint32_t max, bool oneline, const std::string& file)
+{
   git_revwalk *walker = nullptr;
-  int err = git_revwalk_new(&walker, m_repo.get());
+  int err = git_revwalk_new(&walker, repo);
   CROW_LOG_INFO << "git_revwalk_new() err: " << err;
   if (err != 0)
   {
     CROW_LOG_ERROR << "git_revwalk_new() err = " << err;
     CROW_LOG_ERROR << giterr_last()->message;
     
-    return;
+    return false;
   }
 
-  err = git_revwalk_push_ref(walker, git_reference_name(m_ref.get()));
-  CROW_LOG_INFO << "git_revwalk_push_ref() err: " << err;
+  err = git_revwalk_push(walker, &head);
+  CROW_LOG_INFO << "git_revwalk_push() err: " << err;
   if (err != 0)
   {
-    CROW_LOG_ERROR << "git_revwalk_push_ref() err = " << err;
+    CROW_LOG_ERROR << "git_revwalk_push() err = " << err;
     CROW_LOG_ERROR << giterr_last()->message;
     git_revwalk_free(walker);
 
-    return;
+    return false;
   }
 
   git_revwalk_simplify_first_parent(walker);
 
+  // Literal paths compare tree entry oids, wildcards need the tree diff.
+  const std::vector<std::string> parts = split_path(file);
   git_pathspec* pathspec = nullptr;
   git_diff_options opt = GIT_DIFF_FIND_OPTIONS_INIT;
-  if (!file.empty())
+  if (!file.empty() && parts.empty())
   {
     char* filepath = (char*)file.c_str();
     opt.pathspec.strings = &filepath;
@@ -592,11 +1791,15 @@ void Git2API::git_log(std::stringstream &ss, uint32_t max, bool oneline, const s
   uint32_t count = 0;
   git_oid oid;
   git_commit* commit = nullptr;
-  for (; !git_revwalk_next(&oid, walker); git_commit_free(commit))
+  for (; ss && !git_revwalk_next(&oid, walker); git_commit_free(commit))
   {
-    if (!git_commit_lookup(&commit, m_repo.get(), &oid))
+    if (!git_commit_lookup(&commit, repo, &oid))
     {
-      if (pathspec)
+      if (!parts.empty() && !touches_path(commit, parts))
+      {
+        continue;
+      }
+      else if (pathspec)
       {
         uint32_t parents = git_commit_parentcount(commit);
         unmatched = static_cast<int>(parents);
@@ -653,6 +1856,8 @@ void Git2API::git_log(std::stringstream &ss, uint32_t max, bool oneline, const s
   }
   git_pathspec_free(pathspec);
   git_revwalk_free(walker);
+
+  return true;
 }
 
 } // rest4git
@@ -6,17 +6,59 @@
 /// Currently there is no detailed description available.
 /// \todo Add more detailed description!
 
+#pragma once
 #include <string>
 #ifdef LIBGIT2_AVAILABLE
+#include <atomic>
 #include <cstdint>
 #include <sstream>
 #include <memory>
+#include <mutex>
+#include <vector>
 #include <git2.h>
 #include "singleton.h"
+#include "repo_pool.h"
+#include "lru_cache.h"
+#include "blame_result.h"
+#include "blob_lines.h"
+#include "path_index.h"
+#include "trigram_index.h"
+#include "path_history.h"
+#include "redis_cache.h"
+#include "blame_warmup.h"
+#include "ref_watcher.h"
 
 namespace rest4git
 {
 
+const size_t CACHE_SHARDS = 16;
+const size_t BLAME_CACHE_CAPACITY = 64 * 1024 * 1024;
+const size_t BLAME_BASE_CAPACITY = 32 * 1024 * 1024;
+const size_t LOG_CACHE_CAPACITY = 32 * 1024 * 1024;
+const size_t BLOB_CACHE_CAPACITY = 128 * 1024 * 1024;
+const size_t TRACE_MAX_FRAMES = 256;
+const uint32_t TRACE_MAX_CONTEXT = 50;
+/// New commits diffed to carry cached results over to a new HEAD.
+const uint32_t CARRY_OVER_MAX_COMMITS = 10000;
+
+/// HEAD as of the last reference change, replaced as a whole.
+struct HeadState
+{
+  bool born;
+  git_oid oid;
+  /// Shorthand of the branch, "HEAD" if detached, empty if unborn.
+  std::string branch;
+};
+
+typedef std::shared_ptr<const HeadState> HeadStatePtr;
+
+/// One stack frame of /trace/v2, path may be a basename.
+struct TraceFrame
+{
+  std::string path;
+  uint32_t line;
+};
+
 class Git2API : public Notcopyable
 {
 public:
@@ -24,22 +66,87 @@ public:
 public:
   void git_status(std::stringstream& ss);
   void git_branch(std::stringstream& ss, bool all = false);
-  void git_lf_files(std::stringstream& ss, const std::string& pattern);
-  void git_blame(std::stringstream& ss, const std::string& file, uint32_t from = 1, uint32_t to = 0);
+  /// Files of HEAD containing \p pattern, at most \p limit of them if not 0.
+  void git_lf_files(std::stringstream& ss, const std::string& pattern, uint32_t limit = 0);
+  /// Blame and log write as they go, \p ss may be a streamed response.
+  /// They stop early once it goes bad.
+  void git_blame(std::ostream& ss, const std::string& file, uint32_t from = 1, uint32_t to = 0);
   void git_show(std::stringstream& ss, const std::string& file, uint32_t from = 1, uint32_t to = 0);
-  void git_log(std::stringstream& ss, uint32_t max = 0, bool oneline = false, const std::string& file = "");
+  void git_log(std::ostream& ss, uint32_t max = 0, bool oneline = false, const std::string& file = "");
+  /// Blames every frame with \p context lines around it, as JSON.
+  void git_blame_trace(std::stringstream& ss, const std::vector<TraceFrame>& frames, uint32_t context);
 public:
-  const std::string& current_branch_name() const;
+  /// HEAD commit as seen by the calling thread, false without one.
+  bool head_id(git_oid& head);
+  /// Strong ETag of a show, or with \p blame of a blame, of \p file lines
+  /// \p from to \p to. Only answers from the current path index, so it
+  /// never does git work; false if it cannot tell.
+  bool etag(const std::string& file, uint32_t from, uint32_t to, bool blame, std::string& tag);
+  /// True if \p file is a file in the HEAD tree.
+  bool file_exists(const std::string& file);
+  std::string current_branch_name() const;
+  void cache_stats(std::stringstream& ss) const;
 protected:
   explicit Git2API();
   virtual ~Git2API();
 protected:
-  bool okay(std::stringstream &ss) const;
+  bool okay(std::ostream& ss) const;
   bool okay() const;
+  /// Handle of the calling thread, nullptr with an error in \p ss if none.
+  git_repository* repository(std::ostream& ss);
+  /// HEAD from the snapshot, or read from the repository if unwatched.
+  int resolve_head(git_oid& head);
+  /// Rereads HEAD and swaps the snapshot, on the watcher thread.
+  void refresh_head();
+  /// Rekeys the cached blames and logs of files no commit in \p from..\p to
+  /// changed to \p to and evicts the others, false if \p to does not
+  /// descend from \p from.
+  bool carry_over(git_repository* repo, const git_oid& from, const git_oid& to);
+  BlameResultPtr blame_file(std::ostream& ss, git_repository* repo, const git_oid& head,
+    const git_oid& blob, const std::string& file);
+  PathIndexPtr path_index(git_repository* repo, const git_oid& head);
+  /// Index of \p head, or the previous one while the next is being built.
+  TrigramIndexPtr trigram_index(git_repository* repo, const git_oid& head);
+  /// Builds the index of \p head unless current, with m_trigrams_mutex held.
+  TrigramIndexPtr build_trigrams(git_repository* repo, const git_oid& head);
+  bool blob_id(std::ostream& ss, git_repository* repo, const git_oid& head,
+    const std::string& file, git_oid& blob);
+  BlobLinesPtr blob_lines(std::ostream& ss, git_repository* repo, const git_oid& id);
+  std::shared_ptr<BlameResult> blame_incremental(git_repository* repo, const BlameResult& base,
+    const git_oid& head, const git_oid& blob, const std::string& file);
+  /// False without output if the log has to be walked instead.
+  bool log_indexed(std::ostream& ss, git_repository* repo, const git_oid& head,
+    uint32_t max, bool oneline, const std::string& file);
+  bool log_walk(std::ostream& ss, git_repository* repo, const git_oid& head,
+    uint32_t max, bool oneline, const std::string& file);
+  /// Blames \p file at \p head into the caches, for the warmup job.
+  void warm_file(const git_oid& head, const std::string& file);
 private:
-  std::unique_ptr<git_repository, decltype(&git_repository_free)> m_repo;
-  std::unique_ptr<git_reference, decltype(&git_reference_free)> m_ref;
-  std::string m_current_branch_name;
+  RepoPool m_pool;
+  /// Swapped with std::atomic_store by refresh_head().
+  HeadStatePtr m_head;
+  std::atomic<uint64_t> m_head_changes;
+  std::atomic<uint64_t> m_carry_runs;
+  std::atomic<uint64_t> m_carry_moved;
+  std::atomic<uint64_t> m_carry_evicted;
+  ShardedLruCache<std::string, BlameResultPtr> m_blame_cache;
+  /// Latest blame per path, the base for incremental blames after HEAD moved.
+  ShardedLruCache<std::string, BlameResultPtr> m_blame_base;
+  std::atomic<uint64_t> m_blame_full;
+  std::atomic<uint64_t> m_blame_incremental;
+  ShardedLruCache<std::string, std::shared_ptr<const std::string>> m_log_cache;
+  ShardedLruCache<std::string, BlobLinesPtr> m_blob_cache;
+  RedisCache m_redis;
+  /// Files of the HEAD tree, swapped with std::atomic_store.
+  PathIndexPtr m_paths;
+  std::mutex m_paths_mutex;
+  /// Substring index over the same files, built on first use and rebuilt
+  /// by refresh_head().
+  TrigramIndexPtr m_trigrams;
+  std::mutex m_trigrams_mutex;
+  PathHistory m_history;
+  BlameWarmup m_warmup;
+  RefWatcher m_watcher;
 };
 
 } // rest4git
@@ -0,0 +1,154 @@
+/// \file git_pool.cpp
+/// \brief Implementation for rest4git::GitPool.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// Implementation for the bounded git worker pool
+///
+
+#include <algorithm>
+#include <utility>
+
+#include "git_pool.h"
+#include "server_config.h"
+#include "crow/crow_all.h"
+
+namespace rest4git
+{
+
+GitPool& GitPool::get_instance()
+{
+  static GitPool instance;
+  return instance;
+}
+
+GitPool::GitPool()
+  : m_capacity(0)
+  , m_running(0)
+  , m_stop(false)
+  , m_completed(0)
+  , m_rejected(0)
+{
+}
+
+GitPool::~GitPool()
+{
+  stop();
+}
+
+bool GitPool::start(size_t workers, size_t capacity, std::function<void(size_t)> init)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_threads.empty())
+  {
+    return false;
+  }
+
+  if (workers == 0)
+  {
+    workers = available_cpus();
+  }
+  m_capacity = (capacity == 0 ? workers * GIT_POOL_QUEUE_PER_WORKER : capacity);
+  m_stop = false;
+  for (size_t i = 0; i < workers; ++i)
+  {
+    m_threads.emplace_back([this, i, init]
+    {
+      if (init)
+      {
+        init(i);
+      }
+      run();
+    });
+  }
+  CROW_LOG_INFO << "git pool: " << workers << " workers, " << m_capacity << " queued tasks";
+  return true;
+}
+
+void GitPool::stop()
+{
+  std::vector<std::thread> threads;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+    threads.swap(m_threads);
+  }
+  m_cv.notify_all();
+  for (auto& thread : threads)
+  {
+    thread.join();
+  }
+}
+
+bool GitPool::submit(std::function<void()> task)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_stop || m_threads.empty() || m_queue.size() >= m_capacity)
+    {
+      m_rejected++;
+      return false;
+    }
+    m_queue.push_back(std::move(task));
+  }
+  m_cv.notify_one();
+  return true;
+}
+
+GitPoolStats GitPool::stats() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  GitPoolStats s;
+  s.workers = m_threads.size();
+  s.capacity = m_capacity;
+  s.queued = m_queue.size();
+  s.running = m_running;
+  s.completed = m_completed;
+  s.rejected = m_rejected;
+  return s;
+}
+
+void GitPool::print_stats(std::stringstream& ss) const
+{
+  const GitPoolStats s = stats();
+  ss << "git pool     workers " << s.workers << " running " << s.running
+     << " queued " << s.queued << "/" << s.capacity << " completed " << s.completed
+     << " rejected " << s.rejected << "\n";
+}
+
+void GitPool::run()
+{
+  for (;;)
+  {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+      if (m_queue.empty())
+      {
+        break;
+      }
+      task = std::move(m_queue.front());
+      m_queue.pop_front();
+      m_running++;
+    }
+
+    try
+    {
+      task();
+    }
+    catch (const std::exception& e)
+    {
+      CROW_LOG_ERROR << "git pool task failed: " << e.what();
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_running--;
+    }
+    m_completed++;
+  }
+}
+
+} // rest4git
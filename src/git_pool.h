@@ -0,0 +1,74 @@
+/// \file git_pool.h
+/// \brief Worker threads running the libgit2 work of rest4git routes.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// Route handlers hand blame, log, show and check work to this pool, so
+/// the crow io threads only parse requests and write responses. The queue
+/// is bounded: once it is full submit() fails at once and the caller
+/// answers 503 instead of letting the latency grow without limit.
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "singleton.h"
+
+namespace rest4git
+{
+
+/// Queued tasks per worker thread.
+const size_t GIT_POOL_QUEUE_PER_WORKER = 32;
+/// Seconds a rejected client is asked to wait.
+const uint32_t GIT_POOL_RETRY_AFTER = 1;
+
+struct GitPoolStats
+{
+  size_t workers;
+  size_t capacity;
+  size_t queued;
+  size_t running;
+  uint64_t completed;
+  uint64_t rejected;
+};
+
+class GitPool : public Notcopyable
+{
+public:
+  static rest4git::GitPool& get_instance();
+public:
+  /// \param workers Threads, 0 for one per available CPU.
+  /// \param capacity Queued tasks, 0 for GIT_POOL_QUEUE_PER_WORKER per thread.
+  /// \param init Called on each thread with its index before the first task.
+  bool start(size_t workers = 0, size_t capacity = 0, std::function<void(size_t)> init = nullptr);
+  /// Runs the queued tasks, then joins the threads.
+  void stop();
+  /// Queues \p task, false if the queue is full or the pool is stopped.
+  bool submit(std::function<void()> task);
+  GitPoolStats stats() const;
+  void print_stats(std::stringstream& ss) const;
+private:
+  explicit GitPool();
+  virtual ~GitPool();
+  void run();
+private:
+  mutable std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<std::function<void()>> m_queue;
+  std::vector<std::thread> m_threads;
+  size_t m_capacity;
+  size_t m_running;
+  bool m_stop;
+  std::atomic<uint64_t> m_completed;
+  std::atomic<uint64_t> m_rejected;
+};
+
+} // rest4git
@@ -0,0 +1,420 @@
+/// \file history_index.cpp
+/// \brief Implementation for rest4git::HistoryIndex.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// On-disk layout, mapping and lookups of the path history index
+///
+
+#ifdef LIBGIT2_AVAILABLE
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "history_index.h"
+#include "crow/crow_all.h"
+
+namespace rest4git
+{
+
+namespace
+{
+
+const char HISTORY_MAGIC[8] = { 'R', '4', 'G', 'H', 'I', 'S', 'T', '\0' };
+
+size_t align8(size_t n)
+{
+  return (n + 7) & ~static_cast<size_t>(7);
+}
+
+uint64_t hash_path(const char* data, size_t size)
+{
+  // FNV-1a
+  uint64_t h = 14695981039346656037ULL;
+  for (size_t i = 0; i < size; ++i)
+  {
+    h ^= static_cast<unsigned char>(data[i]);
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+/// Four probes derived from one hash (double hashing).
+template <typename F>
+void bloom_probes(uint64_t h, uint32_t words, F f)
+{
+  const uint64_t bits = static_cast<uint64_t>(words) * 64;
+  const uint64_t h2 = (h >> 32) | 1;
+  for (uint64_t i = 0; i < 4; ++i)
+  {
+    f(((h + i * h2) & (bits - 1)));
+  }
+}
+
+struct Layout
+{
+  size_t commits;
+  size_t paths;
+  size_t bloom;
+  size_t postings;
+  size_t names;
+  size_t size;
+};
+
+Layout layout_of(const HistoryHeader& h)
+{
+  Layout l;
+  l.commits = align8(sizeof(HistoryHeader));
+  l.paths = l.commits + align8(static_cast<size_t>(h.commits) * sizeof(git_oid));
+  l.bloom = l.paths + static_cast<size_t>(h.paths) * sizeof(HistoryPath);
+  l.postings = l.bloom + static_cast<size_t>(h.bloom_words) * sizeof(uint64_t);
+  l.names = l.postings + align8(static_cast<size_t>(h.postings) * sizeof(uint32_t));
+  l.size = l.names + static_cast<size_t>(h.names_size);
+  return l;
+}
+
+/// Offsets and counts of a mapped file are only trusted once every path
+/// entry lies within the postings and names and every posting names a
+/// commit of the file.
+bool entries_valid(const HistoryHeader& h, const HistoryPath* paths, const uint32_t* postings)
+{
+  for (uint32_t i = 0; i < h.paths; ++i)
+  {
+    const HistoryPath& p = paths[i];
+    if (p.posting_offset > h.postings || p.posting_count > h.postings - p.posting_offset ||
+        p.name_offset > h.names_size || p.name_size > h.names_size - p.name_offset)
+    {
+      return false;
+    }
+  }
+  for (uint64_t i = 0; i < h.postings; ++i)
+  {
+    if (postings[i] >= h.commits)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+void write_padding(std::ofstream& out, size_t written)
+{
+  static const char zeros[8] = { 0 };
+  out.write(zeros, align8(written) - written);
+}
+
+} // namespace
+
+HistoryIndex::HistoryIndex()
+  : m_map(nullptr)
+  , m_map_size(0)
+  , m_header(nullptr)
+  , m_commits(nullptr)
+  , m_paths(nullptr)
+  , m_bloom(nullptr)
+  , m_postings(nullptr)
+  , m_names(nullptr)
+{
+}
+
+HistoryIndex::~HistoryIndex()
+{
+  if (m_map)
+  {
+    ::munmap(m_map, m_map_size);
+  }
+}
+
+HistoryIndexPtr HistoryIndex::load(const std::string& file)
+{
+  int fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return nullptr;
+  }
+
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(HistoryHeader))
+  {
+    ::close(fd);
+    return nullptr;
+  }
+
+  const size_t size = static_cast<size_t>(st.st_size);
+  void* map = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED)
+  {
+    CROW_LOG_ERROR << "mmap " << file << " failed";
+    return nullptr;
+  }
+
+  std::shared_ptr<HistoryIndex> index = std::make_shared<HistoryIndex>();
+  index->m_map = map;
+  index->m_map_size = size;
+
+  const HistoryHeader* header = static_cast<const HistoryHeader*>(map);
+  if (std::memcmp(header->magic, HISTORY_MAGIC, sizeof(HISTORY_MAGIC)) != 0 ||
+      header->version != HISTORY_INDEX_VERSION ||
+      header->bloom_words == 0 || (header->bloom_words & (header->bloom_words - 1)) != 0)
+  {
+    CROW_LOG_ERROR << file << " is not a history index of this version";
+    return nullptr;
+  }
+
+  // Bounded first, so the layout arithmetic cannot wrap around.
+  if (header->postings > size / sizeof(uint32_t) || header->names_size > size)
+  {
+    CROW_LOG_ERROR << file << " is truncated";
+    return nullptr;
+  }
+  const Layout l = layout_of(*header);
+  if (l.size != size)
+  {
+    CROW_LOG_ERROR << file << " is truncated";
+    return nullptr;
+  }
+
+  const char* base = static_cast<const char*>(map);
+  index->m_header = header;
+  index->m_commits = reinterpret_cast<const git_oid*>(base + l.commits);
+  index->m_paths = reinterpret_cast<const HistoryPath*>(base + l.paths);
+  index->m_bloom = reinterpret_cast<const uint64_t*>(base + l.bloom);
+  index->m_postings = reinterpret_cast<const uint32_t*>(base + l.postings);
+  index->m_names = base + l.names;
+  if (!entries_valid(*header, index->m_paths, index->m_postings))
+  {
+    CROW_LOG_ERROR << file << " is corrupt";
+    return nullptr;
+  }
+  return index;
+}
+
+bool HistoryIndex::write(const std::string& file, const std::vector<git_oid>& commits,
+  const HistoryPostings& postings)
+{
+  std::vector<const HistoryPostings::value_type*> sorted;
+  sorted.reserve(postings.size());
+  for (const auto& p : postings)
+  {
+    sorted.push_back(&p);
+  }
+  std::sort(sorted.begin(), sorted.end(),
+    [](const HistoryPostings::value_type* a, const HistoryPostings::value_type* b) { return a->first < b->first; });
+
+  HistoryHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, HISTORY_MAGIC, sizeof(HISTORY_MAGIC));
+  header.version = HISTORY_INDEX_VERSION;
+  header.commits = static_cast<uint32_t>(commits.size());
+  header.paths = static_cast<uint32_t>(sorted.size());
+  header.bloom_words = 1;
+  while (static_cast<size_t>(header.bloom_words) * 64 < sorted.size() * HISTORY_BLOOM_BITS_PER_PATH)
+  {
+    header.bloom_words <<= 1;
+  }
+
+  std::vector<HistoryPath> paths(sorted.size());
+  std::vector<uint64_t> bloom(header.bloom_words, 0);
+  for (size_t i = 0; i < sorted.size(); ++i)
+  {
+    const std::string& name = sorted[i]->first;
+    paths[i].name_offset = header.names_size;
+    paths[i].name_size = static_cast<uint32_t>(name.size());
+    paths[i].posting_offset = header.postings;
+    paths[i].posting_count = static_cast<uint32_t>(sorted[i]->second.size());
+    header.names_size += name.size();
+    header.postings += sorted[i]->second.size();
+    bloom_probes(hash_path(name.data(), name.size()), header.bloom_words,
+      [&bloom](uint64_t bit) { bloom[bit >> 6] |= 1ULL << (bit & 63); });
+  }
+
+  const std::string tmp = file + ".tmp";
+  {
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+      CROW_LOG_ERROR << "cannot write " << tmp;
+      return false;
+    }
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_padding(out, sizeof(header));
+    out.write(reinterpret_cast<const char*>(commits.data()), commits.size() * sizeof(git_oid));
+    write_padding(out, commits.size() * sizeof(git_oid));
+    out.write(reinterpret_cast<const char*>(paths.data()), paths.size() * sizeof(HistoryPath));
+    out.write(reinterpret_cast<const char*>(bloom.data()), bloom.size() * sizeof(uint64_t));
+    for (const auto* p : sorted)
+    {
+      out.write(reinterpret_cast<const char*>(p->second.data()), p->second.size() * sizeof(uint32_t));
+    }
+    write_padding(out, header.postings * sizeof(uint32_t));
+    for (const auto* p : sorted)
+    {
+      out.write(p->first.data(), p->first.size());
+    }
+
+    out.flush();
+    if (!out)
+    {
+      CROW_LOG_ERROR << "cannot write " << tmp;
+      std::remove(tmp.c_str());
+      return false;
+    }
+  }
+
+  if (std::rename(tmp.c_str(), file.c_str()) != 0)
+  {
+    CROW_LOG_ERROR << "cannot rename " << tmp;
+    std::remove(tmp.c_str());
+    return false;
+  }
+  return true;
+}
+
+HistoryIndexPtr HistoryIndex::create(const std::vector<git_oid>& commits, const HistoryPostings& postings)
+{
+  std::shared_ptr<HistoryIndex> index = std::make_shared<HistoryIndex>();
+  index->m_extra_commits = commits;
+  index->m_extra = postings;
+  return index;
+}
+
+HistoryIndexPtr HistoryIndex::extend(const std::vector<git_oid>& commits,
+  const std::vector<std::vector<std::string>>& changes) const
+{
+  std::shared_ptr<HistoryIndex> index = std::make_shared<HistoryIndex>();
+  index->m_header = m_header;
+  index->m_commits = m_commits;
+  index->m_paths = m_paths;
+  index->m_bloom = m_bloom;
+  index->m_postings = m_postings;
+  index->m_names = m_names;
+  index->m_base = m_map ? shared_from_this() : m_base;
+  index->m_extra_commits = m_extra_commits;
+  index->m_extra = m_extra;
+
+  uint32_t ordinal = this->commits();
+  for (size_t i = 0; i < commits.size(); ++i, ++ordinal)
+  {
+    index->m_extra_commits.push_back(commits[i]);
+    for (const auto& path : changes[i])
+    {
+      index->m_extra[path].push_back(ordinal);
+    }
+  }
+  return index;
+}
+
+void HistoryIndex::collect(std::vector<git_oid>& commits, HistoryPostings& postings) const
+{
+  const uint32_t base = m_header ? m_header->commits : 0;
+  commits.assign(m_commits, m_commits + base);
+  commits.insert(commits.end(), m_extra_commits.begin(), m_extra_commits.end());
+
+  postings.clear();
+  for (uint32_t i = 0; m_header && i < m_header->paths; ++i)
+  {
+    const HistoryPath& p = m_paths[i];
+    std::vector<uint32_t>& ordinals = postings[std::string(m_names + p.name_offset, p.name_size)];
+    ordinals.assign(m_postings + p.posting_offset, m_postings + p.posting_offset + p.posting_count);
+  }
+  for (const auto& extra : m_extra)
+  {
+    std::vector<uint32_t>& ordinals = postings[extra.first];
+    ordinals.insert(ordinals.end(), extra.second.begin(), extra.second.end());
+  }
+}
+
+bool HistoryIndex::lookup(const std::string& path, std::vector<uint32_t>& ordinals) const
+{
+  ordinals.clear();
+  bool found = false;
+  const HistoryPath* p = find(path);
+  if (p)
+  {
+    ordinals.assign(m_postings + p->posting_offset, m_postings + p->posting_offset + p->posting_count);
+    found = true;
+  }
+
+  auto extra = m_extra.find(path);
+  if (extra != m_extra.end())
+  {
+    ordinals.insert(ordinals.end(), extra->second.begin(), extra->second.end());
+    found = true;
+  }
+  return found;
+}
+
+const git_oid& HistoryIndex::commit(uint32_t ordinal) const
+{
+  const uint32_t base = m_header ? m_header->commits : 0;
+  return (ordinal < base) ? m_commits[ordinal] : m_extra_commits[ordinal - base];
+}
+
+const git_oid& HistoryIndex::head() const
+{
+  return commit(commits() - 1);
+}
+
+uint32_t HistoryIndex::commits() const
+{
+  return (m_header ? m_header->commits : 0) + static_cast<uint32_t>(m_extra_commits.size());
+}
+
+uint32_t HistoryIndex::overlay_commits() const
+{
+  return static_cast<uint32_t>(m_extra_commits.size());
+}
+
+size_t HistoryIndex::paths() const
+{
+  return (m_header ? m_header->paths : 0) + m_extra.size();
+}
+
+bool HistoryIndex::mapped() const
+{
+  return m_header != nullptr;
+}
+
+const HistoryPath* HistoryIndex::find(const std::string& path) const
+{
+  if (!m_header || !may_contain(path))
+  {
+    return nullptr;
+  }
+
+  const HistoryPath* begin = m_paths;
+  const HistoryPath* end = m_paths + m_header->paths;
+  const HistoryPath* it = std::lower_bound(begin, end, path,
+    [this](const HistoryPath& p, const std::string& key)
+    {
+      const size_t n = std::min(static_cast<size_t>(p.name_size), key.size());
+      int cmp = std::memcmp(m_names + p.name_offset, key.data(), n);
+      return cmp < 0 || (cmp == 0 && p.name_size < key.size());
+    });
+  if (it == end || it->name_size != path.size() ||
+      std::memcmp(m_names + it->name_offset, path.data(), path.size()) != 0)
+  {
+    return nullptr;
+  }
+  return it;
+}
+
+bool HistoryIndex::may_contain(const std::string& path) const
+{
+  bool hit = true;
+  bloom_probes(hash_path(path.data(), path.size()), m_header->bloom_words,
+    [this, &hit](uint64_t bit) { hit = hit && (m_bloom[bit >> 6] & (1ULL << (bit & 63))); });
+  return hit;
+}
+
+} // rest4git
+
+#endif // LIBGIT2_AVAILABLE
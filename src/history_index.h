@@ -0,0 +1,114 @@
+/// \file history_index.h
+/// \brief Per-path commit history index for rest4git.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// Commits on the first-parent chain of HEAD are numbered from the root
+/// (ordinal 0) upwards. For every path the index keeps the ascending
+/// ordinals of the commits that touched it, so a file history is a lookup
+/// instead of a revwalk.
+///
+/// The bulk of the index lives in a file that is mapped read-only:
+///
+///   HistoryHeader
+///   git_oid    commits[commits]            padded to 8 bytes
+///   HistoryPath paths[paths]               sorted by name
+///   uint64_t   bloom[bloom_words]          prefilter over the names
+///   uint32_t   postings[postings]          padded to 8 bytes
+///   char       names[names_size]
+///
+/// Commits added after the file was written are kept in an in-memory
+/// overlay until the next rewrite. A snapshot is immutable.
+
+#pragma once
+#ifdef LIBGIT2_AVAILABLE
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <git2.h>
+#include "singleton.h"
+
+namespace rest4git
+{
+
+const uint32_t HISTORY_INDEX_VERSION = 1;
+const size_t HISTORY_BLOOM_BITS_PER_PATH = 10;
+
+/// Path to ascending commit ordinals.
+typedef std::unordered_map<std::string, std::vector<uint32_t>> HistoryPostings;
+
+struct HistoryHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t commits;
+  uint32_t paths;
+  uint32_t bloom_words;
+  uint64_t postings;
+  uint64_t names_size;
+};
+
+struct HistoryPath
+{
+  uint64_t name_offset;
+  uint64_t posting_offset;
+  uint32_t name_size;
+  uint32_t posting_count;
+};
+
+class HistoryIndex : public Notcopyable, public std::enable_shared_from_this<HistoryIndex>
+{
+public:
+  /// Maps a file written by write(), nullptr if it is missing or invalid.
+  static std::shared_ptr<const HistoryIndex> load(const std::string& file);
+  /// Writes the index atomically (temporary file and rename).
+  static bool write(const std::string& file, const std::vector<git_oid>& commits,
+                    const HistoryPostings& postings);
+  /// In-memory index, used if the file cannot be written.
+  static std::shared_ptr<const HistoryIndex> create(const std::vector<git_oid>& commits,
+                                                    const HistoryPostings& postings);
+public:
+  explicit HistoryIndex();
+  virtual ~HistoryIndex();
+public:
+  /// New snapshot with \p commits appended, changes[i] touched by commits[i].
+  std::shared_ptr<const HistoryIndex> extend(const std::vector<git_oid>& commits,
+    const std::vector<std::vector<std::string>>& changes) const;
+  /// Copies the whole index out, e.g. to rewrite the file.
+  void collect(std::vector<git_oid>& commits, HistoryPostings& postings) const;
+  /// Ascending ordinals of the commits that touched \p path.
+  bool lookup(const std::string& path, std::vector<uint32_t>& ordinals) const;
+  const git_oid& commit(uint32_t ordinal) const;
+  /// Newest indexed commit, only valid if commits() > 0.
+  const git_oid& head() const;
+  uint32_t commits() const;
+  uint32_t overlay_commits() const;
+  size_t paths() const;
+  bool mapped() const;
+private:
+  const HistoryPath* find(const std::string& path) const;
+  bool may_contain(const std::string& path) const;
+private:
+  void* m_map;
+  size_t m_map_size;
+  const HistoryHeader* m_header;
+  const git_oid* m_commits;
+  const HistoryPath* m_paths;
+  const uint64_t* m_bloom;
+  const uint32_t* m_postings;
+  const char* m_names;
+  /// The mapping is shared by all snapshots extending it.
+  std::shared_ptr<const HistoryIndex> m_base;
+  std::vector<git_oid> m_extra_commits;
+  HistoryPostings m_extra;
+};
+
+typedef std::shared_ptr<const HistoryIndex> HistoryIndexPtr;
+
+} // rest4git
+
+#endif // LIBGIT2_AVAILABLE
@@ -0,0 +1,253 @@
+/// \file lru_cache.h
+/// \brief Sharded, size bounded LRU cache for rest4git.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// Keys are spread over independently locked shards, so concurrent
+/// workers rarely contend on the same mutex. Each shard evicts its least
+/// recently used entries once the summed entry weights exceed its share
+/// of the capacity.
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "singleton.h"
+
+namespace rest4git
+{
+
+struct CacheStats
+{
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t insertions;
+  uint64_t evictions;
+  size_t entries;
+  size_t weight;
+  size_t capacity;
+};
+
+/// Decision of a rekey() visitor for one entry.
+enum class CacheAction
+{
+  Keep,
+  Evict,
+  Move
+};
+
+template <typename K, typename V, typename Hash = std::hash<K>>
+class ShardedLruCache : public Notcopyable
+{
+public:
+  explicit ShardedLruCache(size_t capacity, size_t shards = 16)
+    : m_capacity(capacity)
+    , m_shards(shards == 0 ? 1 : shards)
+    , m_hits(0)
+    , m_misses(0)
+    , m_insertions(0)
+    , m_evictions(0)
+  {
+    for (auto& shard : m_shards)
+    {
+      shard.capacity = m_capacity / m_shards.size();
+    }
+  }
+
+  bool get(const K& key, V& value)
+  {
+    Shard& shard = shard_of(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.map.find(key);
+    if (found == shard.map.end())
+    {
+      m_misses++;
+      return false;
+    }
+
+    // Move to front, most recently used
+    shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+    value = found->second->value;
+    m_hits++;
+    return true;
+  }
+
+  void put(const K& key, const V& value, size_t weight = 1)
+  {
+    Shard& shard = shard_of(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (store(shard, key, value, weight))
+    {
+      m_insertions++;
+    }
+  }
+
+  bool erase(const K& key)
+  {
+    Shard& shard = shard_of(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto found = shard.map.find(key);
+    if (found == shard.map.end())
+    {
+      return false;
+    }
+    shard.weight -= found->second->weight;
+    shard.lru.erase(found->second);
+    shard.map.erase(found);
+    return true;
+  }
+
+  /// Calls \p f(key, new_key) for every entry. Entries it answers with
+  /// CacheAction::Move are reinserted under new_key, keeping their
+  /// recency order, those answered with CacheAction::Evict count as
+  /// evictions. Returns the number of moved entries.
+  template <typename F>
+  size_t rekey(F f)
+  {
+    std::vector<Entry> moved;
+    for (auto& shard : m_shards)
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      for (auto it = shard.lru.begin(); it != shard.lru.end();)
+      {
+        K next;
+        const CacheAction action = f(it->key, next);
+        if (action == CacheAction::Keep)
+        {
+          ++it;
+          continue;
+        }
+        if (action == CacheAction::Move)
+        {
+          moved.push_back(Entry{std::move(next), it->value, it->weight});
+        }
+        else
+        {
+          m_evictions++;
+        }
+        shard.weight -= it->weight;
+        shard.map.erase(it->key);
+        it = shard.lru.erase(it);
+      }
+    }
+
+    // Least recently used first, so the most recent ends up in front. A
+    // moved entry is no new insertion.
+    for (auto it = moved.rbegin(); it != moved.rend(); ++it)
+    {
+      Shard& shard = shard_of(it->key);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      store(shard, it->key, it->value, it->weight);
+    }
+    return moved.size();
+  }
+
+  void clear()
+  {
+    for (auto& shard : m_shards)
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      shard.lru.clear();
+      shard.map.clear();
+      shard.weight = 0;
+    }
+  }
+
+  CacheStats stats() const
+  {
+    CacheStats s = { m_hits, m_misses, m_insertions, m_evictions, 0, 0, m_capacity };
+    for (auto& shard : m_shards)
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      s.entries += shard.map.size();
+      s.weight += shard.weight;
+    }
+    return s;
+  }
+
+private:
+  struct Entry
+  {
+    K key;
+    V value;
+    size_t weight;
+  };
+
+  struct Shard
+  {
+    Shard() : weight(0), capacity(0) {}
+    mutable std::mutex mutex;
+    std::list<Entry> lru;
+    std::unordered_map<K, typename std::list<Entry>::iterator, Hash> map;
+    size_t weight;
+    size_t capacity;
+  };
+
+  /// Adds or replaces \p key in \p shard, whose lock the caller holds, and
+  /// evicts down to its capacity. True if the key was not cached before.
+  bool store(Shard& shard, const K& key, const V& value, size_t weight)
+  {
+    if (weight > shard.capacity)
+    {
+      // Would evict the whole shard and still not fit.
+      return false;
+    }
+
+    bool inserted = false;
+    auto found = shard.map.find(key);
+    if (found != shard.map.end())
+    {
+      shard.weight -= found->second->weight;
+      found->second->value = value;
+      found->second->weight = weight;
+      shard.weight += weight;
+      shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+    }
+    else
+    {
+      shard.lru.push_front(Entry{key, value, weight});
+      shard.map.emplace(key, shard.lru.begin());
+      shard.weight += weight;
+      inserted = true;
+    }
+
+    while (shard.weight > shard.capacity && !shard.lru.empty())
+    {
+      Entry& last = shard.lru.back();
+      shard.weight -= last.weight;
+      shard.map.erase(last.key);
+      shard.lru.pop_back();
+      m_evictions++;
+    }
+    return inserted;
+  }
+
+  Shard& shard_of(const K& key)
+  {
+    // Mix the bits, std::hash of integers is the identity.
+    size_t h = Hash()(key);
+    h ^= h >> 17;
+    h *= 0xed5ad4bbU;
+    h ^= h >> 11;
+    return m_shards[h % m_shards.size()];
+  }
+
+private:
+  const size_t m_capacity;
+  std::vector<Shard> m_shards;
+  std::atomic<uint64_t> m_hits;
+  std::atomic<uint64_t> m_misses;
+  std::atomic<uint64_t> m_insertions;
+  std::atomic<uint64_t> m_evictions;
+};
+
+} // rest4git
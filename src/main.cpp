@@ -7,19 +7,40 @@
 /// main function for rest4git web application/service
 ///
 
+#include <atomic>
 #include <bits/stdint-uintn.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
 #include <sstream>
 #include <string>
 #include <unistd.h>
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
 
 #include "crow/crow_all.h"
 #include "syscmd.h"
 #include "git_commands.h"
+#include "lru_cache.h"
+#include "server_config.h"
+#include "thread_stats.h"
+#include "utils.h"
 #ifdef LIBGIT2_AVAILABLE
+  #include "chunk_streambuf.h"
   #include "git2api.h"
+  #include "git_pool.h"
+  #include "single_flight.h"
 #endif
 
 
+/// Sub-requests accepted by one /batch/v2 call.
+const size_t BATCH_MAX_REQUESTS = 256;
+/// Smaller bodies are sent uncompressed.
+const size_t COMPRESSION_MIN_SIZE = 1024;
+/// Bytes of encoded bodies kept for responses with an ETag.
+const size_t COMPRESSED_CACHE_CAPACITY = 64 * 1024 * 1024;
+
 bool is_number(const std::string& s)
 {
     return !s.empty() && 
@@ -30,8 +51,399 @@ bool is_number(const std::string& s)
                         }) == s.end();
 }
 
-int main()
+typedef std::shared_ptr<const std::string> SharedBody;
+
+/// Encoded bodies of tagged responses by ETag and coding, so an unchanged
+/// blame or show is compressed once.
+rest4git::ShardedLruCache<std::string, SharedBody>& compressed_bodies()
+{
+  static rest4git::ShardedLruCache<std::string, SharedBody> instance(COMPRESSED_CACHE_CAPACITY);
+  return instance;
+}
+
+#ifdef LIBGIT2_AVAILABLE
+typedef std::shared_ptr<const crow::response> SharedResponse;
+
+/// Identical requests against the same HEAD share one computation.
+rest4git::SingleFlight<SharedResponse>& flights()
+{
+  static rest4git::SingleFlight<SharedResponse> instance;
+  return instance;
+}
+
+/// Method, path, sorted query parameters, HEAD and body of \p req, so that
+/// equivalent requests get the same key.
+std::string flight_key(const crow::request& req)
+{
+  std::vector<std::string> params;
+  std::string::size_type pos = req.raw_url.find('?');
+  while (pos != std::string::npos)
+  {
+    const std::string::size_type next = req.raw_url.find('&', pos + 1);
+    params.push_back(req.raw_url.substr(pos + 1, next == std::string::npos ? std::string::npos : next - pos - 1));
+    pos = next;
+  }
+  std::sort(params.begin(), params.end());
+
+  std::string key(crow::method_name(req.method));
+  key += ' ';
+  key += req.url;
+  for (const auto& param : params)
+  {
+    key += '&';
+    key += param;
+  }
+  key += '\n';
+  git_oid head;
+  if (rest4git::Git2API::get_instance().head_id(head))
+  {
+    key.append(reinterpret_cast<const char*>(head.id), sizeof(head.id));
+  }
+  key += '\n';
+  key += req.body;
+  return key;
+}
+
+/// Result of \p work with the body moved into a buffer the waiters share.
+SharedResponse run_shared(const std::function<crow::response()>& work)
+{
+  std::shared_ptr<crow::response> out = std::make_shared<crow::response>();
+  try
+  {
+    *out = work();
+  }
+  catch (const std::exception& e)
+  {
+    CROW_LOG_ERROR << "An uncaught exception occurred: " << e.what();
+    *out = crow::response(500);
+  }
+  if (out->body.empty() && out->json_value.t() == crow::json::type::Object)
+  {
+    out->body = crow::json::dump(out->json_value);
+    out->json_value.clear();
+  }
+  out->shared_body = std::make_shared<const std::string>(std::move(out->body));
+  out->body.clear();
+  return out;
+}
+
+/// Runs \p work on the git pool and completes \p res with its result on
+/// the io thread of the connection, or answers 503 at once if the pool is
+/// saturated. A request equal to one in flight waits for that result
+/// instead. Requests without an io_service (batch) run inline.
+void dispatch(const crow::request& req, crow::response& res, std::function<crow::response()> work)
+{
+  if (req.io_service == nullptr)
+  {
+    res = work();
+    res.end();
+    return;
+  }
+
+  boost::asio::io_service* io = req.io_service;
+  crow::response* target = &res;
+  const std::string key = flight_key(req);
+  const bool leader = flights().join(key, [io, target](const SharedResponse& out) {
+    // The connection is not thread-safe, write the response on its thread.
+    io->post([target, out]() {
+      target->code = out->code;
+      target->headers = out->headers;
+      target->shared_body = out->shared_body;
+      target->end();
+    });
+  });
+  if (!leader)
+  {
+    return;
+  }
+
+  const bool queued = rest4git::GitPool::get_instance().submit([key, work]() {
+    flights().complete(key, run_shared(work));
+  });
+  if (!queued)
+  {
+    std::shared_ptr<crow::response> busy = std::make_shared<crow::response>(503);
+    busy->shared_body = std::make_shared<const std::string>("Server busy, retry later!");
+    busy->set_header("Retry-After", std::to_string(rest4git::GIT_POOL_RETRY_AFTER));
+    flights().complete(key, busy);
+  }
+}
+
+/// True if the If-None-Match header of \p req names \p tag or is "*".
+bool etag_matches(const crow::request& req, const std::string& tag)
+{
+  const std::string& header = req.get_header_value("If-None-Match");
+  return header == "*" || (!header.empty() && header.find(tag) != std::string::npos);
+}
+
+/// Answers 304 if the client already holds \p tag.
+bool not_modified(const crow::request& req, crow::response& res, const std::string& tag)
+{
+  if (!etag_matches(req, tag))
+  {
+    return false;
+  }
+  res.code = 304;
+  res.set_header("ETag", tag);
+  res.end();
+  return true;
+}
+
+/// Runs \p work on the git pool and sends what it writes as a chunked
+/// response while it runs, so the output never has to fit in memory. A
+/// non-empty result of \p tag, asked right before \p work starts, is sent
+/// as ETag. Requests without an io_service (batch) run inline.
+void dispatch_stream(const crow::request& req, crow::response& res, std::function<void(std::ostream&)> work,
+  std::function<std::string()> tag = nullptr)
+{
+  if (req.io_service == nullptr)
+  {
+    std::stringstream ss;
+    work(ss);
+    res = crow::response(ss.str());
+    res.end();
+    return;
+  }
+
+  boost::asio::io_service* io = req.io_service;
+  crow::response* target = &res;
+  const bool queued = rest4git::GitPool::get_instance().submit([io, target, work, tag]() {
+    std::shared_ptr<crow::body_stream> stream = std::make_shared<crow::body_stream>(rest4git::STREAM_QUEUE_SIZE);
+    const std::string etag = tag ? tag() : std::string();
+    // The headers go out at once, the body follows as it is written.
+    io->post([target, stream, etag]() {
+      if (!etag.empty())
+      {
+        target->set_header("ETag", etag);
+      }
+      target->stream = stream;
+      target->end();
+    });
+
+    rest4git::ChunkStreamBuf buf(stream);
+    std::ostream os(&buf);
+    bool complete = true;
+    try
+    {
+      work(os);
+    }
+    catch (const std::exception& e)
+    {
+      CROW_LOG_ERROR << "An uncaught exception occurred: " << e.what();
+      complete = false;
+    }
+    // A partial body must not end like a complete one, it would match the
+    // ETag sent up front.
+    if (complete && buf.finish() && !stream->cancelled())
+    {
+      stream->close();
+    }
+    else
+    {
+      stream->abort();
+    }
+  });
+  if (!queued)
+  {
+    res.code = 503;
+    res.set_header("Retry-After", std::to_string(rest4git::GIT_POOL_RETRY_AFTER));
+    res.end("Server busy, retry later!");
+  }
+}
+
+/// dispatch_stream() if \p stream, otherwise dispatch() of the output.
+void dispatch_output(const crow::request& req, crow::response& res, bool stream,
+  std::function<void(std::ostream&)> work)
+{
+  if (stream)
+  {
+    dispatch_stream(req, res, work);
+    return;
+  }
+  dispatch(req, res, [work]() {
+    std::stringstream ss;
+    work(ss);
+    return ss.str();
+  });
+}
+
+/// dispatch() for a blame or show of \p file, whose result is determined
+/// by git objects. A client already holding its ETag gets 304 before any
+/// git work, every other response carries the ETag.
+void dispatch_tagged(const crow::request& req, crow::response& res, bool blame,
+  const std::string& file, uint32_t from, uint32_t to, std::function<crow::response()> work)
+{
+  std::string tag;
+  if (!rest4git::Git2API::get_instance().etag(file, from, to, blame, tag))
+  {
+    dispatch(req, res, work);
+    return;
+  }
+  if (not_modified(req, res, tag))
+  {
+    return;
+  }
+
+  dispatch(req, res, [work, file, from, to, blame, tag]() {
+    crow::response out = work();
+    // HEAD may have moved meanwhile, a stale tag is left out.
+    std::string current;
+    if (out.code == 200 && rest4git::Git2API::get_instance().etag(file, from, to, blame, current) && current == tag)
+    {
+      out.set_header("ETag", tag);
+    }
+    return out;
+  });
+}
+
+/// dispatch_tagged() for output streamed by dispatch_stream().
+void dispatch_tagged_stream(const crow::request& req, crow::response& res, bool blame,
+  const std::string& file, uint32_t from, uint32_t to, std::function<void(std::ostream&)> work)
+{
+  std::string tag;
+  if (rest4git::Git2API::get_instance().etag(file, from, to, blame, tag) && not_modified(req, res, tag))
+  {
+    return;
+  }
+
+  dispatch_stream(req, res, work, [file, from, to, blame, tag]() {
+    std::string current;
+    const bool same = !tag.empty() && rest4git::Git2API::get_instance().etag(file, from, to, blame, current) &&
+      current == tag;
+    return same ? tag : std::string();
+  });
+}
+
+/// Sub-requests of one /batch/v2 call and their responses, in URL order.
+struct Batch
+{
+  explicit Batch(std::vector<std::string> u)
+    : urls(std::move(u))
+    , responses(urls.size())
+    , next(0)
+    , remaining(urls.size())
+  {
+  }
+
+  std::vector<std::string> urls;
+  std::vector<crow::response> responses;
+  /// Next sub-request to run.
+  std::atomic<size_t> next;
+  /// Sub-requests not finished yet.
+  std::atomic<size_t> remaining;
+};
+
+/// {"responses": [{"url": ..., "code": ..., "body": ...}, ...]}
+crow::response batch_response(const Batch& batch)
+{
+  crow::json::wvalue out;
+  out["responses"] = std::vector<crow::json::wvalue>();
+  for (size_t i = 0; i < batch.urls.size(); ++i)
+  {
+    out["responses"][i]["url"] = batch.urls[i];
+    out["responses"][i]["code"] = batch.responses[i].code;
+    out["responses"][i]["body"] = batch.responses[i].body;
+  }
+  return crow::response(out);
+}
+
+/// Runs the sub-requests of \p urls on up to one git pool task per worker,
+/// each taking the next sub-request until none is left. The task finishing
+/// the last one completes \p res, no task waits for another. Answers 503
+/// if not even one task could be queued.
+void dispatch_batch(crow::SimpleApp& app, const crow::request& req, crow::response& res,
+  std::vector<std::string> urls)
+{
+  boost::asio::io_service* io = req.io_service;
+  crow::response* target = &res;
+  std::shared_ptr<Batch> batch = std::make_shared<Batch>(std::move(urls));
+  if (batch->urls.empty())
+  {
+    res = batch_response(*batch);
+    res.end();
+    return;
+  }
+
+  std::function<void()> runner = [&app, io, target, batch]() {
+    for (size_t i = batch->next++; i < batch->urls.size(); i = batch->next++)
+    {
+      // Every URL goes through the router like a GET of its own, inline
+      // on this worker since it has no io_service.
+      crow::request sub;
+      sub.method = crow::HTTPMethod::Get;
+      sub.raw_url = batch->urls[i];
+      sub.url = sub.raw_url.substr(0, sub.raw_url.find('?'));
+      sub.url_params = crow::query_string(sub.raw_url);
+      sub.io_service = nullptr;
+      if (sub.url.compare(0, 10, "/batch/v2/") == 0 || sub.url == "/batch/v2")
+      {
+        batch->responses[i] = crow::response(400, "Nested batch requests are not supported!");
+      }
+      else
+      {
+        app.handle(sub, batch->responses[i]);
+      }
+      if (--batch->remaining > 0)
+      {
+        continue;
+      }
+
+      const SharedResponse out = run_shared([batch]() { return batch_response(*batch); });
+      io->post([target, out]() {
+        target->code = out->code;
+        target->headers = out->headers;
+        target->shared_body = out->shared_body;
+        target->end();
+      });
+    }
+  };
+
+  const size_t tasks = std::min(batch->urls.size(), rest4git::GitPool::get_instance().stats().workers);
+  size_t queued = 0;
+  while (queued < tasks && rest4git::GitPool::get_instance().submit(runner))
+  {
+    queued++;
+  }
+  if (queued == 0)
+  {
+    res.code = 503;
+    res.set_header("Retry-After", std::to_string(rest4git::GIT_POOL_RETRY_AFTER));
+    res.end("Server busy, retry later!");
+  }
+}
+#endif
+
+int main(int argc, char* argv[])
 {
+  rest4git::ServerConfig config;
+  std::string error;
+  if (!config.load(argc, argv, error))
+  {
+    std::cerr << "rest4git: " << error << "\n\n";
+    rest4git::ServerConfig::usage(std::cerr);
+    return 1;
+  }
+  if (config.help)
+  {
+    rest4git::ServerConfig::usage(std::cout);
+    return 0;
+  }
+  // Relative to where the server was started, not to the repository.
+  if (!config.unix_socket.empty() && config.unix_socket[0] != '/')
+  {
+    config.unix_socket = rest4git::Utils::pwd() + "/" + config.unix_socket;
+  }
+  // The v1 routes run git in the working directory, Git2API opens it.
+  if (!config.repo.empty() && chdir(config.repo.c_str()) != 0)
+  {
+    std::cerr << "rest4git: cannot change to " << config.repo << ": " << strerror(errno) << "\n";
+    return 1;
+  }
+  const size_t cpus = rest4git::available_cpus();
+  const size_t io_threads = (config.io_threads == 0 ? cpus : config.io_threads);
+  // The OpenMP default is every CPU of the host, even in a container.
+  rest4git::set_openmp_threads(cpus);
+
   crow::SimpleApp app;
 
 #ifdef NDEBUG
@@ -49,23 +461,34 @@ int main()
     return ss.str();
   });
 
-#ifdef LIBGIT2_AVAILABLE
-  CROW_ROUTE(app, "/testme")
+  CROW_ROUTE(app, "/threads/v2")
   ([]() {
-    /**
-     * Placeholder for any REST test
-     * Currently: git log something
-     */
     std::stringstream ss;
-    rest4git::Git2API::get_instance().git_log(ss, 30, false, "src/krn/abap/gen/scsyconv.c");
+    rest4git::ThreadStats::get_instance().print_stats(ss);
     return ss.str();
   });
 
+#ifdef LIBGIT2_AVAILABLE
+  CROW_ROUTE(app, "/testme")
+  ([](const crow::request& req, crow::response& res) {
+    dispatch(req, res, []() {
+      /**
+       * Placeholder for any REST test
+       * Currently: git log something
+       */
+      std::stringstream ss;
+      rest4git::Git2API::get_instance().git_log(ss, 30, false, "src/krn/abap/gen/scsyconv.c");
+      return ss.str();
+    });
+  });
+
   CROW_ROUTE(app, "/status/v2")
-  ([]() {
-    std::stringstream ss;
-    rest4git::Git2API::get_instance().git_status(ss);
-    return ss.str();
+  ([](const crow::request& req, crow::response& res) {
+    dispatch(req, res, []() {
+      std::stringstream ss;
+      rest4git::Git2API::get_instance().git_status(ss);
+      return ss.str();
+    });
   });
 
   CROW_ROUTE(app, "/branch/v2")
@@ -88,200 +511,343 @@ int main()
     return ss.str();
   });
 
-  CROW_ROUTE(app, "/check/v2/<path>")
-  ([](const std::string& path) {
-    std::string param("/");
-    param += path;
-    std::replace(param.begin(), param.end(), '+', ' ');
+  CROW_ROUTE(app, "/cache/v2")
+  ([&app]() {
     std::stringstream ss;
-    rest4git::Git2API::get_instance().git_lf_files(ss, param);
+    rest4git::Git2API::get_instance().cache_stats(ss);
+    rest4git::GitPool::get_instance().print_stats(ss);
+    const rest4git::FlightStats flight = flights().stats();
+    ss << "coalescing   flights " << flight.flights << " coalesced " << flight.coalesced
+       << " in flight " << flight.in_flight << "\n";
+    const rest4git::CacheStats compressed = compressed_bodies().stats();
+    ss << "compressed   hits " << compressed.hits << " misses " << compressed.misses
+       << " entries " << compressed.entries << " weight " << compressed.weight << "/" << compressed.capacity << "\n";
+    ss << "connections  reused " << app.connections_reused() << "\n";
     return ss.str();
   });
 
+  CROW_ROUTE(app, "/check/v2/<path>")
+  ([](const crow::request& req, crow::response& res, const std::string& path) {
+    dispatch(req, res, [req, path]() {
+      std::string param("/");
+      param += path;
+      std::replace(param.begin(), param.end(), '+', ' ');
+      // limit is optional, 0 lists every match.
+      uint32_t limit = 0;
+      if (req.url_params.get("limit") != nullptr)
+      {
+        std::string limit_str(req.url_params.get("limit"));
+        if (!is_number(limit_str))
+        {
+          return std::string("Invalid parameter limit!");
+        }
+        limit = std::stoul(limit_str);
+      }
+      std::stringstream ss;
+      rest4git::Git2API::get_instance().git_lf_files(ss, param, limit);
+      return ss.str();
+    });
+  });
+
   CROW_ROUTE(app, "/blame/v2/<uint>/<uint>/<path>")
-  ([](uint32_t fromLine, uint32_t toLine, const std::string& path) {
+  ([](const crow::request& req, crow::response& res, uint32_t fromLine, uint32_t toLine, const std::string& path) {
     std::string param(path);
     std::replace(param.begin(), param.end(), '+', ' ');
-    if (rest4git::SysCmd::file_exists(param))
-    {
-      std::stringstream ss;
-      rest4git::Git2API::get_instance().git_blame(ss, param, 
-        std::min(fromLine, toLine), std::max(fromLine, toLine));
-      return ss.str();
-    }
-    return std::string("File " + param + " not found!");
+    dispatch_tagged(req, res, true, param, std::min(fromLine, toLine), std::max(fromLine, toLine), [fromLine, toLine, param]() {
+      if (rest4git::Git2API::get_instance().file_exists(param))
+      {
+        std::stringstream ss;
+        rest4git::Git2API::get_instance().git_blame(ss, param, 
+          std::min(fromLine, toLine), std::max(fromLine, toLine));
+        return ss.str();
+      }
+      return std::string("File " + param + " not found!");
+    });
   });
 
   CROW_ROUTE(app, "/blame/v2/<uint>/<path>")
-  ([](uint32_t line, const std::string& path) {
+  ([](const crow::request& req, crow::response& res, uint32_t line, const std::string& path) {
     std::string param(path);
     std::replace(param.begin(), param.end(), '+', ' ');
-    if (rest4git::SysCmd::file_exists(param))
-    {
-      std::stringstream ss;
-      rest4git::Git2API::get_instance().git_blame(ss, param, line, line);
-      return ss.str();
-    }
-    return std::string("File " + param + " not found!");
+    dispatch_tagged(req, res, true, param, line, line, [line, param]() {
+      if (rest4git::Git2API::get_instance().file_exists(param))
+      {
+        std::stringstream ss;
+        rest4git::Git2API::get_instance().git_blame(ss, param, line, line);
+        return ss.str();
+      }
+      return std::string("File " + param + " not found!");
+    });
   });
 
   CROW_ROUTE(app, "/blame/v2/<path>")
-  ([](const std::string& path) {
+  ([](const crow::request& req, crow::response& res, const std::string& path) {
     std::string param(path);
     std::replace(param.begin(), param.end(), '+', ' ');
-    if (rest4git::SysCmd::file_exists(param))
+    // Whole files are streamed, their blame can be many megabytes.
+    dispatch_tagged_stream(req, res, true, param, 1, 0, [param](std::ostream& os) {
+      if (rest4git::Git2API::get_instance().file_exists(param))
+      {
+        rest4git::Git2API::get_instance().git_blame(os, param);
+        return;
+      }
+      os << "File " << param << " not found!";
+    });
+  });
+
+  CROW_ROUTE(app, "/batch/v2")
+    .methods(crow::HTTPMethod::Post)
+  ([&app](const crow::request& req, crow::response& res) {
+    // ["/show/v2/10/20/src/a.c", "/commit/oneline/v2/5/src/a.c", ...]
+    std::vector<std::string> urls;
+    std::string error;
+    try
     {
-      std::stringstream ss;
-      rest4git::Git2API::get_instance().git_blame(ss, param);
-      return ss.str();
+      crow::json::rvalue body = crow::json::load(req.body);
+      if (!body || body.t() != crow::json::type::List)
+      {
+        error = "A JSON array of URLs is mandatory!";
+      }
+      else if (body.size() > BATCH_MAX_REQUESTS)
+      {
+        error = "Too many requests!";
+      }
+      else
+      {
+        for (const auto& url : body)
+        {
+          urls.push_back(url.s());
+        }
+      }
     }
-    return std::string("File " + param + " not found!");
+    catch (const std::exception& e)
+    {
+      error = std::string("Invalid requests: ") + e.what();
+    }
+    if (!error.empty())
+    {
+      res.code = 400;
+      res.end(error);
+      return;
+    }
+    dispatch_batch(app, req, res, std::move(urls));
+  });
+
+  CROW_ROUTE(app, "/trace/v2")
+    .methods(crow::HTTPMethod::Post)
+  ([](const crow::request& req, crow::response& res) {
+    dispatch(req, res, [req]() {
+      // {"context": 3, "frames": [{"path": "Type.h", "line": 42}, ...]}
+      std::vector<rest4git::TraceFrame> frames;
+      uint32_t context = 3;
+      try
+      {
+        crow::json::rvalue body = crow::json::load(req.body);
+        if (!body || !body.has("frames") || body["frames"].t() != crow::json::type::List)
+        {
+          return crow::response(400, "Argument frames is mandatory!");
+        }
+        if (body.has("context"))
+        {
+          context = std::min(static_cast<uint32_t>(body["context"].u()), rest4git::TRACE_MAX_CONTEXT);
+        }
+        if (body["frames"].size() > rest4git::TRACE_MAX_FRAMES)
+        {
+          return crow::response(400, "Too many frames!");
+        }
+        for (const auto& f : body["frames"])
+        {
+          frames.push_back(rest4git::TraceFrame{ f["path"].s(), static_cast<uint32_t>(f["line"].u()) });
+        }
+      }
+      catch (const std::exception& e)
+      {
+        return crow::response(400, std::string("Invalid frames: ") + e.what());
+      }
+
+      std::stringstream ss;
+      rest4git::Git2API::get_instance().git_blame_trace(ss, frames, context);
+      crow::response out(ss.str());
+      out.set_header("Content-Type", "application/json");
+      return out;
+    });
   });
 
   CROW_ROUTE(app, "/show/v2/<uint>/<uint>/<path>")
-  ([](uint32_t fromLine, uint32_t toLine, const std::string& path) {
+  ([](const crow::request& req, crow::response& res, uint32_t fromLine, uint32_t toLine, const std::string& path) {
     std::string param(path);
     std::replace(param.begin(), param.end(), '+', ' ');
-    if (rest4git::SysCmd::file_exists(param))
-    {
-      std::stringstream ss;
-      rest4git::Git2API::get_instance().git_show(ss, param, std::min(fromLine, toLine), std::max(fromLine, toLine));
-      return ss.str();
-    }
-    return std::string("File " + param + " not found!");
+    dispatch_tagged(req, res, false, param, std::min(fromLine, toLine), std::max(fromLine, toLine), [fromLine, toLine, param]() {
+      if (rest4git::Git2API::get_instance().file_exists(param))
+      {
+        std::stringstream ss;
+        rest4git::Git2API::get_instance().git_show(ss, param, std::min(fromLine, toLine), std::max(fromLine, toLine));
+        return ss.str();
+      }
+      return std::string("File " + param + " not found!");
+    });
   });
 
   CROW_ROUTE(app, "/show/v2/<uint>/<path>")
-  ([](uint32_t line, const std::string& path) {
+  ([](const crow::request& req, crow::response& res, uint32_t line, const std::string& path) {
     std::string param(path);
     std::replace(param.begin(), param.end(), '+', ' ');
-    if (rest4git::SysCmd::file_exists(param))
-    {
-      std::stringstream ss;
-      rest4git::Git2API::get_instance().git_show(ss, param, line, line);
-      return ss.str();
-    }
-    return std::string("File " + param + " not found!");
+    dispatch_tagged(req, res, false, param, line, line, [line, param]() {
+      if (rest4git::Git2API::get_instance().file_exists(param))
+      {
+        std::stringstream ss;
+        rest4git::Git2API::get_instance().git_show(ss, param, line, line);
+        return ss.str();
+      }
+      return std::string("File " + param + " not found!");
+    });
   });
 
   CROW_ROUTE(app, "/show/v2/<path>")
-  ([](const std::string& path) {
+  ([](const crow::request& req, crow::response& res, const std::string& path) {
     std::string param(path);
     std::replace(param.begin(), param.end(), '+', ' ');
-    if (rest4git::SysCmd::file_exists(param))
-    {
-      std::stringstream ss;
-      rest4git::Git2API::get_instance().git_show(ss, param);
-      return ss.str();
-    }
-    return std::string("File " + param + " not found!");
+    dispatch_tagged(req, res, false, param, 1, 0, [param]() {
+      if (rest4git::Git2API::get_instance().file_exists(param))
+      {
+        std::stringstream ss;
+        rest4git::Git2API::get_instance().git_show(ss, param);
+        return ss.str();
+      }
+      return std::string("File " + param + " not found!");
+    });
   });
 
   CROW_ROUTE(app, "/show/v2")
-  ([](const crow::request& req) {
-    std::string file;
-    uint32_t from = 1;
-    uint32_t to = 0;
-    // file-path is mandatory
-    if (req.url_params.get("file-path") != nullptr)
-    {
-      file = req.url_params.get("file-path");
-      std::replace(file.begin(), file.end(), '+', ' ');
-      if (!rest4git::SysCmd::file_exists(file))
+  ([](const crow::request& req, crow::response& res) {
+    std::function<crow::response()> work = [req]() {
+      std::string file;
+      uint32_t from = 1;
+      uint32_t to = 0;
+      // file-path is mandatory
+      if (req.url_params.get("file-path") != nullptr)
       {
-        return std::string("File " + file + " not found!");
-      }
-    }
-    else 
-    {
-      return std::string("Argument file-name is mandatory!");
-    }
-    // from-line name is optional, support one line as well.
-    if (req.url_params.get("from-line") != nullptr)
-    {
-      std::string from_str(req.url_params.get("from-line"));
-      if (is_number(from_str))
-      {
-        from = std::stoi(from_str);
+        file = req.url_params.get("file-path");
+        std::replace(file.begin(), file.end(), '+', ' ');
+        if (!rest4git::Git2API::get_instance().file_exists(file))
+        {
+          return std::string("File " + file + " not found!");
+        }
       }
       else 
       {
-        return std::string("Invalid parameter from-line!");
+        return std::string("Argument file-name is mandatory!");
       }
-      if (req.url_params.get("to-line") != nullptr)
+      // from-line name is optional, support one line as well.
+      if (req.url_params.get("from-line") != nullptr)
       {
-        std::string to_str(req.url_params.get("to-line"));
-        if (is_number(to_str))
+        std::string from_str(req.url_params.get("from-line"));
+        if (is_number(from_str))
         {
-          to = std::stoi(to_str);
+          from = std::stoi(from_str);
         }
         else 
         {
-          return std::string("Invalid parameter to-line!");
+          return std::string("Invalid parameter from-line!");
+        }
+        if (req.url_params.get("to-line") != nullptr)
+        {
+          std::string to_str(req.url_params.get("to-line"));
+          if (is_number(to_str))
+          {
+            to = std::stoi(to_str);
+          }
+          else 
+          {
+            return std::string("Invalid parameter to-line!");
+          }
+        }
+        else
+        {
+          to = from;
         }
       }
-      else
-      {
-        to = from;
-      }
+      std::stringstream ss;
+      rest4git::Git2API::get_instance().git_show(ss, file, std::min(from, to), std::max(from, to));
+      return ss.str();
+    };
+
+    // Only well-formed requests are tagged, the work answers the others.
+    const char* file = req.url_params.get("file-path");
+    const char* from = req.url_params.get("from-line");
+    const char* to = req.url_params.get("to-line");
+    if (file == nullptr || (from != nullptr && !is_number(from)) || (from != nullptr && to != nullptr && !is_number(to)))
+    {
+      dispatch(req, res, work);
+      return;
     }
-    std::stringstream ss;
-    rest4git::Git2API::get_instance().git_show(ss, file, std::min(from, to), std::max(from, to));
-    return ss.str();
+    std::string param(file);
+    std::replace(param.begin(), param.end(), '+', ' ');
+    const uint32_t first = from ? std::stoi(from) : 1;
+    const uint32_t last = from ? (to ? std::stoi(to) : first) : 0;
+    dispatch_tagged(req, res, false, param, std::min(first, last), std::max(first, last), work);
   });
 
   CROW_ROUTE(app, "/commit/v2/<uint>/<path>")
-  ([](uint32_t numberOfCommits, const std::string& path) {
-    std::string param(path);
-    std::replace(param.begin(), param.end(), '+', ' ');
-    if (rest4git::SysCmd::file_exists(param))
-    {
-      std::stringstream ss;
-      rest4git::Git2API::get_instance().git_log(ss, numberOfCommits, false, param);
-      return ss.str();
-    }
-    return std::string("File " + param + " not found!");
+  ([](const crow::request& req, crow::response& res, uint32_t numberOfCommits, const std::string& path) {
+    // The whole history (0) is streamed.
+    dispatch_output(req, res, numberOfCommits == 0, [numberOfCommits, path](std::ostream& os) {
+      std::string param(path);
+      std::replace(param.begin(), param.end(), '+', ' ');
+      if (rest4git::Git2API::get_instance().file_exists(param))
+      {
+        rest4git::Git2API::get_instance().git_log(os, numberOfCommits, false, param);
+        return;
+      }
+      os << "File " << param << " not found!";
+    });
   });
 
   CROW_ROUTE(app, "/commit/oneline/v2/<uint>/<path>")
-  ([](uint32_t numberOfCommits, const std::string& path) {
-    std::string param(path);
-    std::replace(param.begin(), param.end(), '+', ' ');
-    if (rest4git::SysCmd::file_exists(param))
-    {
-      std::stringstream ss;
-      rest4git::Git2API::get_instance().git_log(ss, numberOfCommits, true, param);
-      return ss.str();
-    }
-    return std::string("File " + param + " not found!");
+  ([](const crow::request& req, crow::response& res, uint32_t numberOfCommits, const std::string& path) {
+    // The whole history (0) is streamed.
+    dispatch_output(req, res, numberOfCommits == 0, [numberOfCommits, path](std::ostream& os) {
+      std::string param(path);
+      std::replace(param.begin(), param.end(), '+', ' ');
+      if (rest4git::Git2API::get_instance().file_exists(param))
+      {
+        rest4git::Git2API::get_instance().git_log(os, numberOfCommits, true, param);
+        return;
+      }
+      os << "File " << param << " not found!";
+    });
   });
 
   CROW_ROUTE(app, "/commit/v2/<uint>")
-  ([](uint32_t numberOfCommits) {
-    std::stringstream ss;
-    rest4git::Git2API::get_instance().git_log(ss, numberOfCommits);
-    return ss.str();
+  ([](const crow::request& req, crow::response& res, uint32_t numberOfCommits) {
+    dispatch_output(req, res, numberOfCommits == 0, [numberOfCommits](std::ostream& os) {
+      rest4git::Git2API::get_instance().git_log(os, numberOfCommits);
+    });
   });
 
   CROW_ROUTE(app, "/commit/oneline/v2/<uint>")
-  ([](uint32_t numberOfCommits) {
-    std::stringstream ss;
-    rest4git::Git2API::get_instance().git_log(ss, numberOfCommits, true);
-    return ss.str();
+  ([](const crow::request& req, crow::response& res, uint32_t numberOfCommits) {
+    dispatch_output(req, res, numberOfCommits == 0, [numberOfCommits](std::ostream& os) {
+      rest4git::Git2API::get_instance().git_log(os, numberOfCommits, true);
+    });
   });
 
   CROW_ROUTE(app, "/commit/oneline/v2")
-  ([]() {
-    std::stringstream ss;
-    rest4git::Git2API::get_instance().git_log(ss, 50, true);
-    return ss.str();
+  ([](const crow::request& req, crow::response& res) {
+    dispatch(req, res, []() {
+      std::stringstream ss;
+      rest4git::Git2API::get_instance().git_log(ss, 50, true);
+      return ss.str();
+    });
   });
 
   CROW_ROUTE(app, "/commit/v2")
-  ([]() {
-    std::stringstream ss;
-    rest4git::Git2API::get_instance().git_log(ss, 50);
-    return ss.str();
+  ([](const crow::request& req, crow::response& res) {
+    dispatch(req, res, []() {
+      std::stringstream ss;
+      rest4git::Git2API::get_instance().git_log(ss, 50);
+      return ss.str();
+    });
   });
 #endif
 
@@ -563,7 +1129,79 @@ int main()
 
 // End of REST routing
 
-  app.port(8000).multithreaded().run();
+#ifdef LIBGIT2_AVAILABLE
+  const size_t git_workers = (config.git_workers == 0 ? cpus : config.git_workers);
+  rest4git::GitPool::get_instance().start(git_workers, config.git_queue, [&config, cpus, git_workers](size_t index) {
+    rest4git::pin_thread(config.git_cpus);
+#ifdef _OPENMP
+    // The workers run side by side, each gets its share of their CPUs.
+    const size_t shared = (config.git_cpus.empty() ? cpus : config.git_cpus.size());
+    omp_set_num_threads(static_cast<int>(std::max<size_t>(1, shared / git_workers)));
+#endif
+    rest4git::ThreadStats::get_instance().add("git-" + std::to_string(index));
+  });
+#endif
+
+#ifdef CROW_ENABLE_COMPRESSION
+  app.use_compression(COMPRESSION_MIN_SIZE)
+    .compression_cache([](const std::string& key, const crow::compression::compress_function& compress) {
+      SharedBody body;
+      if (!compressed_bodies().get(key, body))
+      {
+        body = compress();
+        compressed_bodies().put(key, body, body->size() + key.size());
+      }
+      return body;
+    });
+#endif
+
+  // Each io thread gets a CPU of its own, the accepting thread shares them.
+  app.thread_init([&config, cpus, io_threads](int index) {
+    rest4git::limit_openmp();
+    if (index >= 0)
+    {
+      if (!config.io_cpus.empty())
+      {
+        rest4git::pin_thread(std::vector<int>(1, config.io_cpus[index % config.io_cpus.size()]));
+      }
+      rest4git::ThreadStats::get_instance().add("io-" + std::to_string(index));
+      return;
+    }
+
+    // Runs once every io thread is up.
+    rest4git::pin_thread(config.io_cpus);
+    rest4git::ThreadStats::get_instance().add("accept");
+    std::stringstream ss;
+    ss << "rest4git " << config.bindaddr << ":" << config.port;
+    if (!config.unix_socket.empty())
+    {
+      ss << " and unix:" << config.unix_socket;
+    }
+    ss << " serving " << rest4git::Utils::pwd() << ", " << cpus << " CPUs available, " << io_threads << " io threads";
+    if (!config.io_cpus.empty())
+    {
+      ss << " on CPUs " << rest4git::format_cpu_list(config.io_cpus);
+    }
+    if (!config.git_cpus.empty())
+    {
+      ss << ", git workers on CPUs " << rest4git::format_cpu_list(config.git_cpus);
+    }
+    ss << "\n";
+    rest4git::ThreadStats::get_instance().print_stats(ss);
+    std::cout << ss.str() << std::flush;
+  });
+
+  if (!config.unix_socket.empty())
+  {
+    app.unix_socket(config.unix_socket, config.unix_socket_mode);
+  }
+
+  app.bindaddr(config.bindaddr).port(config.port).concurrency(io_threads).reuse_port(config.reuse_port)
+    .connection_pool(config.connection_pool).run();
+
+#ifdef LIBGIT2_AVAILABLE
+  rest4git::GitPool::get_instance().stop();
+#endif
 
   return 0;
 }
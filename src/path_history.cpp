@@ -0,0 +1,322 @@
+/// \file path_history.cpp
+/// \brief Implementation for rest4git::PathHistory.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// Builds and extends the path history index in the background
+///
+
+#ifdef LIBGIT2_AVAILABLE
+#include <algorithm>
+#include <iterator>
+#include <memory>
+
+#include "path_history.h"
+#include "server_config.h"
+#include "crow/crow_all.h"
+
+namespace rest4git
+{
+
+namespace
+{
+
+bool changed_paths(git_repository* repo, git_tree* old_tree, git_tree* new_tree, std::vector<std::string>& paths)
+{
+  git_diff_options opt = GIT_DIFF_OPTIONS_INIT;
+  opt.flags = GIT_DIFF_SKIP_BINARY_CHECK;
+  git_diff* diff = nullptr;
+  if (git_diff_tree_to_tree(&diff, repo, old_tree, new_tree, &opt) != 0)
+  {
+    return false;
+  }
+
+  const size_t n = git_diff_num_deltas(diff);
+  paths.reserve(n);
+  for (size_t i = 0; i < n; ++i)
+  {
+    const git_diff_delta* delta = git_diff_get_delta(diff, i);
+    paths.push_back(delta->status == GIT_DELTA_DELETED ? delta->old_file.path : delta->new_file.path);
+  }
+  git_diff_free(diff);
+  std::sort(paths.begin(), paths.end());
+  return true;
+}
+
+} // namespace
+
+PathHistory::PathHistory()
+  : m_pool(nullptr)
+  , m_pending(false)
+  , m_stop(false)
+  , m_busy(false)
+  , m_writable(true)
+{
+}
+
+PathHistory::~PathHistory()
+{
+  stop();
+}
+
+bool PathHistory::start(RepoPool& pool, const std::string& file)
+{
+  if (m_thread.joinable())
+  {
+    return false;
+  }
+
+  m_pool = &pool;
+  m_file = file;
+  m_stop = false;
+  m_thread = std::thread([this] { run(); });
+  return true;
+}
+
+void PathHistory::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_cv.notify_all();
+  if (m_thread.joinable())
+  {
+    m_thread.join();
+  }
+}
+
+void PathHistory::request(const git_oid& head)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_target = head;
+    m_pending = true;
+  }
+  m_cv.notify_one();
+}
+
+HistoryIndexPtr PathHistory::index() const
+{
+  return std::atomic_load(&m_index);
+}
+
+bool PathHistory::busy() const
+{
+  return m_busy;
+}
+
+void PathHistory::run()
+{
+  // The builder diffs commits in parallel, within the process's CPUs.
+  limit_openmp();
+  HistoryIndexPtr loaded = HistoryIndex::load(m_file);
+  if (loaded && loaded->commits() > 0)
+  {
+    CROW_LOG_INFO << "history index loaded: " << loaded->commits() << " commits";
+    std::atomic_store(&m_index, loaded);
+  }
+
+  for (;;)
+  {
+    git_oid target;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait(lock, [this] { return m_stop || m_pending; });
+      if (m_stop)
+      {
+        break;
+      }
+      target = m_target;
+      m_pending = false;
+    }
+
+    m_busy = true;
+    update(target);
+    m_busy = false;
+  }
+}
+
+void PathHistory::update(const git_oid& head)
+{
+  HistoryIndexPtr current = index();
+  if (current && current->commits() > 0 && git_oid_equal(&current->head(), &head))
+  {
+    return;
+  }
+
+  std::vector<git_oid> chain;
+  bool reached = false;
+  if (!first_parent_chain(m_pool->get(), head, current, chain, reached))
+  {
+    return;
+  }
+
+  std::vector<std::vector<std::string>> changes(chain.size());
+  std::atomic<bool> failed(false);
+  const long count = static_cast<long>(chain.size());
+  #pragma omp parallel for schedule(dynamic, 64)
+  for (long i = 0; i < count; ++i)
+  {
+    if (m_stop || failed)
+    {
+      continue;
+    }
+    if (!touched_paths(m_pool->get(), chain[i], changes[i]))
+    {
+      failed = true;
+    }
+  }
+
+  if (m_stop)
+  {
+    return;
+  }
+  if (failed)
+  {
+    CROW_LOG_ERROR << "history index: diffing commits failed";
+    return;
+  }
+
+  HistoryIndexPtr next;
+  if (reached)
+  {
+    next = current->extend(chain, changes);
+    if (next->overlay_commits() > HISTORY_OVERLAY_MAX && m_writable)
+    {
+      std::vector<git_oid> commits;
+      HistoryPostings postings;
+      next->collect(commits, postings);
+      next = persist(commits, postings);
+    }
+  }
+  else
+  {
+    HistoryPostings postings;
+    for (size_t i = 0; i < changes.size(); ++i)
+    {
+      for (const auto& path : changes[i])
+      {
+        postings[path].push_back(static_cast<uint32_t>(i));
+      }
+    }
+    next = persist(chain, postings);
+  }
+
+  CROW_LOG_INFO << "history index: " << next->commits() << " commits, "
+                << chain.size() << (reached ? " appended" : " rebuilt");
+  std::atomic_store(&m_index, next);
+}
+
+HistoryIndexPtr PathHistory::persist(const std::vector<git_oid>& commits, const HistoryPostings& postings)
+{
+  if (m_writable && HistoryIndex::write(m_file, commits, postings))
+  {
+    HistoryIndexPtr loaded = HistoryIndex::load(m_file);
+    if (loaded)
+    {
+      return loaded;
+    }
+  }
+
+  // Read-only git directory, keep the index in memory only.
+  m_writable = false;
+  return HistoryIndex::create(commits, postings);
+}
+
+bool PathHistory::first_parent_chain(git_repository* repo, const git_oid& head, const HistoryIndexPtr& index,
+  std::vector<git_oid>& chain, bool& reached)
+{
+  reached = false;
+  git_oid id = head;
+  for (;;)
+  {
+    if (index && index->commits() > 0 && git_oid_equal(&id, &index->head()))
+    {
+      reached = true;
+      break;
+    }
+    if (m_stop)
+    {
+      return false;
+    }
+
+    git_commit* commit = nullptr;
+    int err = git_commit_lookup(&commit, repo, &id);
+    if (err != 0)
+    {
+      CROW_LOG_ERROR << "git_commit_lookup() err = " << err;
+      return false;
+    }
+    chain.push_back(id);
+    const bool root = (git_commit_parentcount(commit) == 0);
+    if (!root)
+    {
+      id = *git_commit_parent_id(commit, 0);
+    }
+    git_commit_free(commit);
+    if (root)
+    {
+      break;
+    }
+  }
+
+  std::reverse(chain.begin(), chain.end());
+  return true;
+}
+
+bool PathHistory::touched_paths(git_repository* repo, const git_oid& id, std::vector<std::string>& paths)
+{
+  // Same rule as the revwalk: a path counts if it differs from every parent.
+  git_commit* commit = nullptr;
+  if (git_commit_lookup(&commit, repo, &id) != 0)
+  {
+    return false;
+  }
+
+  git_tree* tree = nullptr;
+  if (git_commit_tree(&tree, commit) != 0)
+  {
+    git_commit_free(commit);
+    return false;
+  }
+
+  bool ok = true;
+  const unsigned int parents = git_commit_parentcount(commit);
+  if (parents == 0)
+  {
+    ok = changed_paths(repo, nullptr, tree, paths);
+  }
+  for (unsigned int i = 0; ok && i < parents; ++i)
+  {
+    git_commit* parent = nullptr;
+    git_tree* parent_tree = nullptr;
+    std::vector<std::string> changed;
+    ok = git_commit_parent(&parent, commit, i) == 0 &&
+         git_commit_tree(&parent_tree, parent) == 0 &&
+         changed_paths(repo, parent_tree, tree, changed);
+    git_tree_free(parent_tree);
+    git_commit_free(parent);
+
+    if (i == 0)
+    {
+      paths.swap(changed);
+    }
+    else
+    {
+      std::vector<std::string> common;
+      std::set_intersection(paths.begin(), paths.end(), changed.begin(), changed.end(),
+        std::back_inserter(common));
+      paths.swap(common);
+    }
+  }
+
+  git_tree_free(tree);
+  git_commit_free(commit);
+  return ok;
+}
+
+} // rest4git
+
+#endif // LIBGIT2_AVAILABLE
@@ -0,0 +1,69 @@
+/// \file path_history.h
+/// \brief Background builder of the path history index for rest4git.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// Loads the index file from the git directory at startup and keeps it in
+/// step with HEAD on a background thread: new commits on the first-parent
+/// chain are appended, anything else (reset, rebase) rebuilds the index.
+/// Commits are diffed in parallel, every OpenMP thread with its own
+/// repository handle from the pool.
+
+#pragma once
+#ifdef LIBGIT2_AVAILABLE
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <git2.h>
+#include "singleton.h"
+#include "repo_pool.h"
+#include "history_index.h"
+
+namespace rest4git
+{
+
+/// Overlay commits kept in memory before the index file is rewritten.
+const uint32_t HISTORY_OVERLAY_MAX = 4096;
+
+class PathHistory : public Notcopyable
+{
+public:
+  explicit PathHistory();
+  virtual ~PathHistory();
+public:
+  /// \param file Index file, e.g. in the git directory.
+  bool start(RepoPool& pool, const std::string& file);
+  void stop();
+  /// Asks the background thread to index up to \p head, never blocks.
+  void request(const git_oid& head);
+  HistoryIndexPtr index() const;
+  bool busy() const;
+private:
+  void run();
+  void update(const git_oid& head);
+  HistoryIndexPtr persist(const std::vector<git_oid>& commits, const HistoryPostings& postings);
+  bool first_parent_chain(git_repository* repo, const git_oid& head, const HistoryIndexPtr& index,
+    std::vector<git_oid>& chain, bool& reached);
+  static bool touched_paths(git_repository* repo, const git_oid& id, std::vector<std::string>& paths);
+private:
+  RepoPool* m_pool;
+  std::string m_file;
+  HistoryIndexPtr m_index;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  git_oid m_target;
+  bool m_pending;
+  std::atomic<bool> m_stop;
+  std::atomic<bool> m_busy;
+  bool m_writable;
+  std::thread m_thread;
+};
+
+} // rest4git
+
+#endif // LIBGIT2_AVAILABLE
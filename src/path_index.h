@@ -0,0 +1,149 @@
+/// \file path_index.h
+/// \brief Path lookup table of one HEAD tree for rest4git.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// Maps every file path of a commit's tree to its blob oid and mode, so
+/// routes can check for a file and find its blob without a tree walk per
+/// request. Files can also be looked up by basename, as stack traces
+/// often name them. A snapshot is immutable and rebuilt when HEAD moves.
+
+#pragma once
+#ifdef LIBGIT2_AVAILABLE
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <git2.h>
+
+namespace rest4git
+{
+
+struct PathEntry
+{
+  git_oid oid;
+  git_filemode_t mode;
+};
+
+class PathIndex
+{
+public:
+  /// Walks the tree of commit \p head, returns nullptr on error.
+  static std::shared_ptr<const PathIndex> build(git_repository* repo, const git_oid& head)
+  {
+    git_commit* commit = nullptr;
+    if (git_commit_lookup(&commit, repo, &head) != 0)
+    {
+      return nullptr;
+    }
+
+    git_tree* tree = nullptr;
+    int err = git_commit_tree(&tree, commit);
+    git_commit_free(commit);
+    if (err != 0)
+    {
+      return nullptr;
+    }
+
+    std::shared_ptr<PathIndex> index = std::make_shared<PathIndex>();
+    index->m_head = head;
+    err = git_tree_walk(tree, GIT_TREEWALK_PRE, &PathIndex::add_entry, index.get());
+    git_tree_free(tree);
+    if (err != 0)
+    {
+      return nullptr;
+    }
+    return index;
+  }
+
+  const git_oid& head() const
+  {
+    return m_head;
+  }
+
+  size_t size() const
+  {
+    return m_entries.size();
+  }
+
+  /// Finds a file, directories and submodules are not files.
+  bool find(const std::string& path, PathEntry& entry) const
+  {
+    auto found = m_entries.find(path);
+    if (found == m_entries.end())
+    {
+      return false;
+    }
+    entry = found->second;
+    return true;
+  }
+
+  bool contains(const std::string& path) const
+  {
+    return m_entries.find(path) != m_entries.end();
+  }
+
+  /// Files matching \p path exactly or, failing that, by basename. With
+  /// directories given, a candidate must end with them, e.g. "krn/Type.h".
+  void resolve(const std::string& path, std::vector<std::string>& files) const
+  {
+    files.clear();
+    if (contains(path))
+    {
+      files.push_back(path);
+      return;
+    }
+
+    const std::string::size_type slash = path.rfind('/');
+    auto found = m_basenames.find(slash == std::string::npos ? path : path.substr(slash + 1));
+    if (found == m_basenames.end())
+    {
+      return;
+    }
+    for (const std::string* file : found->second)
+    {
+      if (slash == std::string::npos ||
+          (file->size() > path.size() && (*file)[file->size() - path.size() - 1] == '/' &&
+           file->compare(file->size() - path.size(), path.size(), path) == 0))
+      {
+        files.push_back(*file);
+      }
+    }
+    std::sort(files.begin(), files.end());
+  }
+
+  const std::unordered_map<std::string, PathEntry>& entries() const
+  {
+    return m_entries;
+  }
+
+private:
+  static int add_entry(const char* root, const git_tree_entry* entry, void* payload)
+  {
+    const git_filemode_t mode = git_tree_entry_filemode(entry);
+    if (mode == GIT_FILEMODE_BLOB || mode == GIT_FILEMODE_BLOB_EXECUTABLE || mode == GIT_FILEMODE_LINK)
+    {
+      PathIndex* index = static_cast<PathIndex*>(payload);
+      std::string path(root);
+      path += git_tree_entry_name(entry);
+      PathEntry e = { *git_tree_entry_id(entry), mode };
+      auto added = index->m_entries.emplace(std::move(path), e);
+      // Keys of an unordered_map keep their address.
+      index->m_basenames[git_tree_entry_name(entry)].push_back(&added.first->first);
+    }
+    return 0;
+  }
+
+private:
+  git_oid m_head;
+  std::unordered_map<std::string, PathEntry> m_entries;
+  std::unordered_map<std::string, std::vector<const std::string*>> m_basenames;
+};
+
+typedef std::shared_ptr<const PathIndex> PathIndexPtr;
+
+} // rest4git
+
+#endif // LIBGIT2_AVAILABLE
@@ -0,0 +1,416 @@
+/// \file redis_cache.cpp
+/// \brief Implementation for rest4git::RedisCache.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// Minimal RESP client: GET and SET EX, pipelined over one connection
+///
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <cstdlib>
+#include <utility>
+
+#include "redis_cache.h"
+#include "crow/crow_all.h"
+
+namespace rest4git
+{
+
+namespace
+{
+
+void append_bulk(std::string& cmd, const std::string& arg)
+{
+  cmd += "$";
+  cmd += std::to_string(arg.size());
+  cmd += "\r\n";
+  cmd += arg;
+  cmd += "\r\n";
+}
+
+} // namespace
+
+RedisCache::RedisCache()
+  : m_timeout(REDIS_TIMEOUT_MS)
+  , m_ttl(REDIS_TTL_SECONDS)
+  , m_stop(false)
+  , m_hits(0)
+  , m_misses(0)
+  , m_timeouts(0)
+  , m_errors(0)
+  , m_stores(0)
+{
+}
+
+RedisCache::~RedisCache()
+{
+  stop();
+}
+
+bool RedisCache::start(const std::string& endpoint, uint32_t timeout_ms, uint32_t ttl)
+{
+  if (endpoint.empty() || m_thread.joinable())
+  {
+    return false;
+  }
+
+  std::string::size_type colon = endpoint.rfind(':');
+  m_host = endpoint.substr(0, colon);
+  m_port = (colon == std::string::npos) ? "6379" : endpoint.substr(colon + 1);
+  m_endpoint = m_host + ":" + m_port;
+  m_timeout = std::chrono::milliseconds(timeout_ms);
+  m_ttl = ttl;
+  m_stop = false;
+  m_retry_at = std::chrono::steady_clock::now();
+  m_thread = std::thread([this] { run(); });
+
+  CROW_LOG_INFO << "redis cache tier: " << m_endpoint;
+  return true;
+}
+
+void RedisCache::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_cv.notify_all();
+  if (m_thread.joinable())
+  {
+    m_thread.join();
+  }
+  disconnect();
+}
+
+bool RedisCache::enabled() const
+{
+  return !m_endpoint.empty();
+}
+
+const std::string& RedisCache::endpoint() const
+{
+  return m_endpoint;
+}
+
+std::future<RedisValue> RedisCache::get_async(const std::string& key)
+{
+  std::shared_ptr<std::promise<RedisValue>> promise = std::make_shared<std::promise<RedisValue>>();
+  std::future<RedisValue> future = promise->get_future();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!enabled() || m_stop || m_queue.size() >= REDIS_MAX_QUEUE)
+    {
+      promise->set_value(nullptr);
+      return future;
+    }
+    m_queue.push_back(Op{false, key, std::string(), promise});
+  }
+  m_cv.notify_one();
+  return future;
+}
+
+bool RedisCache::get(const std::string& key, std::string& value)
+{
+  if (!enabled())
+  {
+    return false;
+  }
+
+  std::future<RedisValue> future = get_async(key);
+  if (future.wait_for(m_timeout) != std::future_status::ready)
+  {
+    // The reply is dropped by the worker once it arrives.
+    m_timeouts++;
+    return false;
+  }
+
+  RedisValue v = future.get();
+  if (!v)
+  {
+    m_misses++;
+    return false;
+  }
+
+  m_hits++;
+  value = *v;
+  return true;
+}
+
+void RedisCache::set_async(const std::string& key, const std::string& value)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!enabled() || m_stop || m_queue.size() >= REDIS_MAX_QUEUE || value.size() > REDIS_MAX_VALUE)
+    {
+      return;
+    }
+    m_queue.push_back(Op{true, key, value, nullptr});
+  }
+  m_cv.notify_one();
+}
+
+RedisStats RedisCache::stats() const
+{
+  RedisStats s = { m_hits, m_misses, m_timeouts, m_errors, m_stores };
+  return s;
+}
+
+void RedisCache::run()
+{
+  for (;;)
+  {
+    std::deque<Op> batch;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+      if (m_stop)
+      {
+        break;
+      }
+      batch.swap(m_queue);
+    }
+
+    if (!execute(batch))
+    {
+      m_errors++;
+      disconnect();
+    }
+
+    // Anything left unanswered is a miss.
+    for (auto& op : batch)
+    {
+      if (op.promise)
+      {
+        op.promise->set_value(nullptr);
+      }
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto& op : m_queue)
+  {
+    if (op.promise)
+    {
+      op.promise->set_value(nullptr);
+    }
+  }
+  m_queue.clear();
+}
+
+bool RedisCache::ensure_connected()
+{
+  if (m_socket && m_socket->is_open())
+  {
+    return true;
+  }
+
+  // Do not hammer a server that is down, lookups just miss meanwhile.
+  if (std::chrono::steady_clock::now() < m_retry_at)
+  {
+    return false;
+  }
+  m_retry_at = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+
+  try
+  {
+    using boost::asio::ip::tcp;
+    tcp::resolver resolver(m_io_service);
+    tcp::resolver::query query(m_host, m_port);
+    std::unique_ptr<tcp::socket> socket(new tcp::socket(m_io_service));
+    boost::asio::connect(*socket, resolver.resolve(query));
+    socket->set_option(tcp::no_delay(true));
+
+    // Bound blocking reads and writes so a stuck server cannot wedge us.
+    struct timeval tv;
+    tv.tv_sec = 1;
+    tv.tv_usec = 0;
+    ::setsockopt(socket->native_handle(), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    ::setsockopt(socket->native_handle(), SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    m_socket = std::move(socket);
+    m_rbuf.clear();
+    CROW_LOG_INFO << "redis connected: " << m_endpoint;
+    return true;
+  }
+  catch (std::exception& e)
+  {
+    CROW_LOG_ERROR << "redis connect " << m_endpoint << " failed: " << e.what();
+    return false;
+  }
+}
+
+void RedisCache::disconnect()
+{
+  if (m_socket)
+  {
+    boost::system::error_code ec;
+    m_socket->close(ec);
+    m_socket.reset();
+  }
+  m_rbuf.clear();
+}
+
+bool RedisCache::execute(std::deque<Op>& batch)
+{
+  if (!ensure_connected())
+  {
+    return true;
+  }
+
+  const std::string ttl = std::to_string(m_ttl);
+  std::string cmd;
+  for (const auto& op : batch)
+  {
+    if (op.set)
+    {
+      cmd += "*5\r\n";
+      append_bulk(cmd, "SET");
+      append_bulk(cmd, op.key);
+      append_bulk(cmd, op.value);
+      append_bulk(cmd, "EX");
+      append_bulk(cmd, ttl);
+    }
+    else
+    {
+      cmd += "*2\r\n";
+      append_bulk(cmd, "GET");
+      append_bulk(cmd, op.key);
+    }
+  }
+
+  boost::system::error_code ec;
+  boost::asio::write(*m_socket, boost::asio::buffer(cmd), ec);
+  if (ec)
+  {
+    CROW_LOG_ERROR << "redis write: " << ec.message();
+    return false;
+  }
+
+  // Replies arrive in command order.
+  while (!batch.empty())
+  {
+    Op op = std::move(batch.front());
+    batch.pop_front();
+
+    bool is_null = false;
+    std::string value;
+    if (!read_reply(is_null, value))
+    {
+      if (op.promise)
+      {
+        op.promise->set_value(nullptr);
+      }
+      return false;
+    }
+
+    if (op.set)
+    {
+      m_stores++;
+    }
+    else if (op.promise)
+    {
+      op.promise->set_value(is_null ? nullptr : std::make_shared<const std::string>(std::move(value)));
+    }
+  }
+
+  return true;
+}
+
+bool RedisCache::read_line(std::string& line)
+{
+  for (;;)
+  {
+    std::string::size_type crlf = m_rbuf.find("\r\n");
+    if (crlf != std::string::npos)
+    {
+      line = m_rbuf.substr(0, crlf);
+      m_rbuf.erase(0, crlf + 2);
+      return true;
+    }
+
+    char buf[4096];
+    boost::system::error_code ec;
+    size_t n = m_socket->read_some(boost::asio::buffer(buf), ec);
+    if (ec)
+    {
+      CROW_LOG_ERROR << "redis read: " << ec.message();
+      return false;
+    }
+    m_rbuf.append(buf, n);
+  }
+}
+
+bool RedisCache::read_bytes(size_t n, std::string& out)
+{
+  while (m_rbuf.size() < n)
+  {
+    char buf[65536];
+    boost::system::error_code ec;
+    size_t r = m_socket->read_some(boost::asio::buffer(buf), ec);
+    if (ec)
+    {
+      CROW_LOG_ERROR << "redis read: " << ec.message();
+      return false;
+    }
+    m_rbuf.append(buf, r);
+  }
+
+  out.assign(m_rbuf, 0, n);
+  m_rbuf.erase(0, n);
+  return true;
+}
+
+bool RedisCache::read_reply(bool& is_null, std::string& value)
+{
+  std::string line;
+  if (!read_line(line) || line.empty())
+  {
+    return false;
+  }
+
+  is_null = false;
+  switch (line[0])
+  {
+    case '+':
+    case ':':
+      value = line.substr(1);
+      return true;
+    case '-':
+      CROW_LOG_ERROR << "redis error reply: " << line.substr(1);
+      is_null = true;
+      return true;
+    case '$':
+    {
+      long len = std::strtol(line.c_str() + 1, nullptr, 10);
+      if (len < 0)
+      {
+        is_null = true;
+        return true;
+      }
+      std::string crlf;
+      return read_bytes(static_cast<size_t>(len), value) && read_bytes(2, crlf);
+    }
+    case '*':
+    {
+      // Not used by GET/SET, skip the elements to stay in sync.
+      long count = std::strtol(line.c_str() + 1, nullptr, 10);
+      for (long i = 0; i < count; ++i)
+      {
+        bool n = false;
+        std::string v;
+        if (!read_reply(n, v))
+        {
+          return false;
+        }
+      }
+      is_null = true;
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+} // rest4git
@@ -0,0 +1,106 @@
+/// \file redis_cache.h
+/// \brief Optional shared cache tier speaking the redis protocol.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// Several rest4git instances serving the same repository mirror can
+/// share computed results through one redis server. Lookups are queued
+/// to a background connection thread and pipelined; callers wait at most
+/// the configured timeout and otherwise compute the result themselves.
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <boost/asio.hpp>
+
+#include "singleton.h"
+
+namespace rest4git
+{
+
+const size_t REDIS_MAX_QUEUE = 1024;
+const size_t REDIS_MAX_VALUE = 4 * 1024 * 1024;
+const uint32_t REDIS_TIMEOUT_MS = 20;
+const uint32_t REDIS_TTL_SECONDS = 7 * 24 * 3600;
+
+typedef std::shared_ptr<const std::string> RedisValue;
+
+struct RedisStats
+{
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t timeouts;
+  uint64_t errors;
+  uint64_t stores;
+};
+
+class RedisCache : public Notcopyable
+{
+public:
+  explicit RedisCache();
+  virtual ~RedisCache();
+public:
+  /// \param endpoint "host:port", the tier stays disabled if empty.
+  bool start(const std::string& endpoint,
+             uint32_t timeout_ms = REDIS_TIMEOUT_MS,
+             uint32_t ttl = REDIS_TTL_SECONDS);
+  void stop();
+  bool enabled() const;
+  /// Queues a GET, the future yields nullptr on a miss or error.
+  std::future<RedisValue> get_async(const std::string& key);
+  /// GET bounded by the configured timeout.
+  bool get(const std::string& key, std::string& value);
+  /// Queues a SET with expiry, dropped if the queue is full.
+  void set_async(const std::string& key, const std::string& value);
+  RedisStats stats() const;
+  const std::string& endpoint() const;
+private:
+  struct Op
+  {
+    bool set;
+    std::string key;
+    std::string value;
+    std::shared_ptr<std::promise<RedisValue>> promise;
+  };
+  void run();
+  bool ensure_connected();
+  void disconnect();
+  bool execute(std::deque<Op>& batch);
+  bool read_line(std::string& line);
+  bool read_bytes(size_t n, std::string& out);
+  bool read_reply(bool& is_null, std::string& value);
+private:
+  std::string m_endpoint;
+  std::string m_host;
+  std::string m_port;
+  std::chrono::milliseconds m_timeout;
+  uint32_t m_ttl;
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::deque<Op> m_queue;
+  bool m_stop;
+  std::thread m_thread;
+
+  boost::asio::io_service m_io_service;
+  std::unique_ptr<boost::asio::ip::tcp::socket> m_socket;
+  std::string m_rbuf;
+  std::chrono::steady_clock::time_point m_retry_at;
+
+  std::atomic<uint64_t> m_hits;
+  std::atomic<uint64_t> m_misses;
+  std::atomic<uint64_t> m_timeouts;
+  std::atomic<uint64_t> m_errors;
+  std::atomic<uint64_t> m_stores;
+};
+
+} // rest4git
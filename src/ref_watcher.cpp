@@ -0,0 +1,247 @@
+/// \file ref_watcher.cpp
+/// \brief Implementation for rest4git::RefWatcher.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// Implementation for the inotify reference watcher
+///
+
+#include <cerrno>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "ref_watcher.h"
+#include "crow/crow_all.h"
+
+namespace rest4git
+{
+
+namespace
+{
+
+const uint32_t REF_WATCH_MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE;
+
+bool ends_with(const char* name, const char* suffix)
+{
+  const size_t n = strlen(name);
+  const size_t m = strlen(suffix);
+  return n >= m && strcmp(name + n - m, suffix) == 0;
+}
+
+} // namespace
+
+RefWatcher::RefWatcher()
+  : m_fd(-1)
+  , m_wake{ -1, -1 }
+  , m_running(false)
+  , m_changes(0)
+{
+}
+
+RefWatcher::~RefWatcher()
+{
+  stop();
+}
+
+bool RefWatcher::start(const std::string& gitdir, const std::string& commondir, Callback changed)
+{
+  if (m_thread.joinable())
+  {
+    return false;
+  }
+
+  m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (m_fd < 0)
+  {
+    CROW_LOG_ERROR << "inotify_init1() failed: " << strerror(errno);
+    return false;
+  }
+  if (pipe2(m_wake, O_NONBLOCK | O_CLOEXEC) != 0)
+  {
+    CROW_LOG_ERROR << "pipe2() failed: " << strerror(errno);
+    close(m_fd);
+    m_fd = -1;
+    return false;
+  }
+
+  m_gitdir = gitdir;
+  m_commondir = commondir;
+  m_changed = changed;
+  // HEAD lives in the git directory, packed-refs next to refs/.
+  bool ok = watch(m_gitdir, false);
+  if (ok && m_commondir != m_gitdir)
+  {
+    ok = watch(m_commondir, false);
+  }
+  if (!ok)
+  {
+    stop();
+    return false;
+  }
+  watch_tree(m_commondir + "refs");
+
+  m_running = true;
+  m_thread = std::thread([this] { run(); });
+  CROW_LOG_INFO << "watching references in " << m_commondir << ", " << m_dirs.size() << " directories";
+  return true;
+}
+
+void RefWatcher::stop()
+{
+  if (m_thread.joinable())
+  {
+    const char c = 0;
+    (void)write(m_wake[1], &c, 1);
+    m_thread.join();
+  }
+  m_running = false;
+  if (m_fd >= 0)
+  {
+    close(m_fd);
+    m_fd = -1;
+  }
+  for (int i = 0; i < 2; ++i)
+  {
+    if (m_wake[i] >= 0)
+    {
+      close(m_wake[i]);
+      m_wake[i] = -1;
+    }
+  }
+  m_dirs.clear();
+}
+
+bool RefWatcher::running() const
+{
+  return m_running;
+}
+
+uint64_t RefWatcher::changes() const
+{
+  return m_changes;
+}
+
+void RefWatcher::run()
+{
+  pollfd fds[2] = { { m_fd, POLLIN, 0 }, { m_wake[0], POLLIN, 0 } };
+  bool pending = false;
+  for (;;)
+  {
+    // Once something changed, wait for the burst to end.
+    const int ready = poll(fds, 2, pending ? static_cast<int>(REF_WATCH_DEBOUNCE_MS) : -1);
+    if (ready < 0 && errno != EINTR)
+    {
+      CROW_LOG_ERROR << "poll() failed: " << strerror(errno);
+      break;
+    }
+    if (fds[1].revents != 0)
+    {
+      break;
+    }
+    if (ready > 0 && (fds[0].revents & POLLIN))
+    {
+      pending = read_events() || pending;
+      continue;
+    }
+    if (pending)
+    {
+      pending = false;
+      m_changes++;
+      m_changed();
+    }
+  }
+  m_running = false;
+}
+
+bool RefWatcher::watch(const std::string& dir, bool refs)
+{
+  const int wd = inotify_add_watch(m_fd, dir.c_str(), REF_WATCH_MASK | IN_ONLYDIR);
+  if (wd < 0)
+  {
+    CROW_LOG_ERROR << "inotify_add_watch(" << dir << ") failed: " << strerror(errno);
+    return false;
+  }
+  m_dirs[wd] = std::make_pair(dir, refs);
+  return true;
+}
+
+void RefWatcher::watch_tree(const std::string& dir)
+{
+  if (!watch(dir, true))
+  {
+    return;
+  }
+
+  DIR* d = opendir(dir.c_str());
+  if (d == nullptr)
+  {
+    return;
+  }
+  while (dirent* entry = readdir(d))
+  {
+    if (entry->d_type == DT_DIR && strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0)
+    {
+      watch_tree(dir + "/" + entry->d_name);
+    }
+  }
+  closedir(d);
+}
+
+bool RefWatcher::read_events()
+{
+  alignas(inotify_event) char buffer[16 * 1024];
+  bool changed = false;
+  for (;;)
+  {
+    const ssize_t len = read(m_fd, buffer, sizeof(buffer));
+    if (len <= 0)
+    {
+      return changed;
+    }
+
+    for (const char* p = buffer; p < buffer + len;)
+    {
+      const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+      p += sizeof(inotify_event) + event->len;
+      if (event->mask & IN_Q_OVERFLOW)
+      {
+        changed = true;
+        continue;
+      }
+
+      auto dir = m_dirs.find(event->wd);
+      if (dir == m_dirs.end())
+      {
+        continue;
+      }
+      if (event->mask & IN_IGNORED)
+      {
+        m_dirs.erase(dir);
+        continue;
+      }
+
+      const char* name = event->len > 0 ? event->name : "";
+      if (dir->second.second)
+      {
+        // New branch namespaces, e.g. refs/heads/feature/.
+        if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO)))
+        {
+          const std::string path = dir->second.first + "/" + name;
+          watch_tree(path);
+        }
+        changed = changed || !ends_with(name, ".lock");
+      }
+      else
+      {
+        changed = changed || strcmp(name, "HEAD") == 0 || strcmp(name, "packed-refs") == 0;
+      }
+    }
+  }
+}
+
+} // rest4git
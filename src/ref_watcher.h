@@ -0,0 +1,64 @@
+/// \file ref_watcher.h
+/// \brief inotify watcher of HEAD and the references for rest4git.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// Watches HEAD, packed-refs and every directory below refs/ of the
+/// served repository. git updates them through a lock file and a rename,
+/// so a pull, commit or checkout shows up as a few events within
+/// milliseconds. Events are collected until the directory is quiet for a
+/// moment, then the callback runs once on the watcher thread.
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "singleton.h"
+
+namespace rest4git
+{
+
+/// Quiet time before a burst of reference events is reported.
+const uint32_t REF_WATCH_DEBOUNCE_MS = 20;
+
+class RefWatcher : public Notcopyable
+{
+public:
+  typedef std::function<void()> Callback;
+public:
+  explicit RefWatcher();
+  virtual ~RefWatcher();
+public:
+  /// \param gitdir Directory holding HEAD, with a trailing slash.
+  /// \param commondir Directory holding refs/ and packed-refs, the same
+  ///        as \p gitdir unless it is a linked worktree.
+  bool start(const std::string& gitdir, const std::string& commondir, Callback changed);
+  void stop();
+  /// True while changes are reported, false if inotify is unavailable.
+  bool running() const;
+  uint64_t changes() const;
+private:
+  void run();
+  bool watch(const std::string& dir, bool refs);
+  void watch_tree(const std::string& dir);
+  /// Reads pending events, true if one of them concerns a reference.
+  bool read_events();
+private:
+  int m_fd;
+  int m_wake[2];
+  std::string m_gitdir;
+  std::string m_commondir;
+  Callback m_changed;
+  /// Watch descriptor to directory, and whether it is below refs/.
+  std::unordered_map<int, std::pair<std::string, bool>> m_dirs;
+  std::atomic<bool> m_running;
+  std::atomic<uint64_t> m_changes;
+  std::thread m_thread;
+};
+
+} // rest4git
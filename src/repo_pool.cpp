@@ -0,0 +1,177 @@
+/// \file repo_pool.cpp
+/// \brief Implementation for rest4git::RepoPool.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// Implementation for the per-thread repository handle pool
+///
+
+#ifdef LIBGIT2_AVAILABLE
+#include <utility>
+
+#include "repo_pool.h"
+#include "crow/crow_all.h"
+
+namespace rest4git
+{
+
+namespace
+{
+
+struct ThreadHandle
+{
+  const RepoPool* owner;
+  git_repository* repo;
+};
+
+// Avoids taking the pool mutex on every call once a thread has its handle.
+thread_local ThreadHandle t_handle = { nullptr, nullptr };
+
+} // namespace
+
+RepoPool::RepoPool()
+  : m_main(nullptr, git_repository_free)
+  , m_odb(nullptr, git_odb_free)
+{
+}
+
+RepoPool::~RepoPool()
+{
+  close();
+}
+
+bool RepoPool::open(const std::string& path)
+{
+  git_repository* repo = nullptr;
+  int err = git_repository_open(&repo, path.c_str());
+  if (err != 0)
+  {
+    CROW_LOG_ERROR << "git_repository_open() err = " << err;
+    CROW_LOG_ERROR << giterr_last()->message;
+    return false;
+  }
+
+  m_path = path;
+  m_main.reset(repo);
+
+  git_odb* odb = nullptr;
+  err = git_repository_odb(&odb, repo);
+  CROW_LOG_INFO << "git_repository_odb() err: " << err;
+  if (err == 0)
+  {
+    m_odb.reset(odb);
+  }
+  else
+  {
+    // Every handle will then use its own object database.
+    CROW_LOG_ERROR << "git_repository_odb() err = " << err;
+    CROW_LOG_ERROR << giterr_last()->message;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_handles[std::this_thread::get_id()] = repo;
+  t_handle = { this, repo };
+
+  return true;
+}
+
+bool RepoPool::okay() const
+{
+  return m_main != nullptr;
+}
+
+git_repository* RepoPool::get()
+{
+  if (!okay())
+  {
+    return nullptr;
+  }
+
+  if (t_handle.owner == this)
+  {
+    return t_handle.repo;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  auto found = m_handles.find(std::this_thread::get_id());
+  git_repository* repo = nullptr;
+  if (found != m_handles.end())
+  {
+    repo = found->second;
+  }
+  else
+  {
+    repo = open_handle();
+    if (repo == nullptr)
+    {
+      // Sharing m_main would let two threads use one handle, fail instead.
+      // The next call tries again.
+      return nullptr;
+    }
+    m_handles.emplace(std::this_thread::get_id(), repo);
+    CROW_LOG_INFO << "Opened repository handle #" << m_handles.size();
+  }
+
+  t_handle = { this, repo };
+  return repo;
+}
+
+void RepoPool::close()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto& h : m_handles)
+  {
+    if (h.second != m_main.get())
+    {
+      git_repository_free(h.second);
+    }
+  }
+  m_handles.clear();
+  m_odb.reset();
+  m_main.reset();
+}
+
+git_repository* RepoPool::main() const
+{
+  return m_main.get();
+}
+
+const std::string& RepoPool::path() const
+{
+  return m_path;
+}
+
+size_t RepoPool::size() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_handles.size();
+}
+
+git_repository* RepoPool::open_handle()
+{
+  git_repository* repo = nullptr;
+  int err = git_repository_open(&repo, m_path.c_str());
+  if (err != 0)
+  {
+    CROW_LOG_ERROR << "git_repository_open() err = " << err;
+    CROW_LOG_ERROR << giterr_last()->message;
+    return nullptr;
+  }
+
+  if (m_odb)
+  {
+    err = git_repository_set_odb(repo, m_odb.get());
+    if (err != 0)
+    {
+      CROW_LOG_ERROR << "git_repository_set_odb() err = " << err;
+      CROW_LOG_ERROR << giterr_last()->message;
+    }
+  }
+
+  return repo;
+}
+
+} // rest4git
+
+#endif // LIBGIT2_AVAILABLE
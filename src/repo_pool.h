@@ -0,0 +1,54 @@
+/// \file repo_pool.h
+/// \brief Per-thread libgit2 repository handles for rest4git.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// A git_repository must not be used by more than one thread at a time,
+/// so every worker thread gets its own handle opened from the same path.
+/// All handles share one object database (pack mmaps and object cache).
+
+#pragma once
+#ifdef LIBGIT2_AVAILABLE
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <git2.h>
+#include "singleton.h"
+
+namespace rest4git
+{
+
+class RepoPool : public Notcopyable
+{
+public:
+  explicit RepoPool();
+  virtual ~RepoPool();
+public:
+  bool open(const std::string& path);
+  /// Frees every handle, must happen before git_libgit2_shutdown().
+  void close();
+  bool okay() const;
+  /// Repository handle owned by the calling thread, opened on first use,
+  /// nullptr if it cannot be opened.
+  git_repository* get();
+  /// Handle opened by open(), e.g. for state shared read-only by all threads.
+  git_repository* main() const;
+  const std::string& path() const;
+  size_t size() const;
+private:
+  git_repository* open_handle();
+private:
+  std::string m_path;
+  std::unique_ptr<git_repository, decltype(&git_repository_free)> m_main;
+  std::unique_ptr<git_odb, decltype(&git_odb_free)> m_odb;
+  mutable std::mutex m_mutex;
+  std::unordered_map<std::thread::id, git_repository*> m_handles;
+};
+
+} // rest4git
+
+#endif // LIBGIT2_AVAILABLE
@@ -0,0 +1,451 @@
+/// \file server_config.cpp
+/// \brief Implementation for rest4git::ServerConfig.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// Implementation for the runtime configuration and CPU placement
+///
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sched.h>
+#include <sstream>
+#include <thread>
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
+#include "server_config.h"
+#include "crow/crow_all.h"
+
+namespace rest4git
+{
+
+namespace
+{
+
+const size_t MAX_CPUS = CPU_SETSIZE;
+
+/// 0 leaves the OpenMP default.
+std::atomic<size_t> g_openmp_threads(0);
+
+struct Option
+{
+  const char* key;
+  const char* env;
+  const char* help;
+};
+
+const Option OPTIONS[] = {
+  { "port",             "REST4GIT_PORT",             "TCP port, default 8000" },
+  { "bind",             "REST4GIT_BIND",             "address to listen on, default 0.0.0.0" },
+  { "unix-socket",      "REST4GIT_UNIX_SOCKET",      "Unix domain socket to listen on as well" },
+  { "unix-socket-mode", "REST4GIT_UNIX_SOCKET_MODE", "permissions of the socket file, default 0660" },
+  { "repo",             "REST4GIT_REPO",             "repository to serve, default the working directory" },
+  { "io-threads",       "REST4GIT_IO_THREADS",       "network threads, default one per available CPU" },
+  { "git-workers",      "REST4GIT_GIT_WORKERS",      "git worker threads, default one per available CPU" },
+  { "git-queue",        "REST4GIT_GIT_QUEUE",        "queued git tasks, default 32 per worker" },
+  { "connection-pool",  "REST4GIT_CONNECTION_POOL",  "closed connections reused per network thread, default 256" },
+  { "io-cpus",          "REST4GIT_IO_CPUS",          "CPUs for the network threads, one each, e.g. 0-1" },
+  { "git-cpus",         "REST4GIT_GIT_CPUS",         "CPUs shared by the git workers, e.g. 2-7" },
+  { "reuse-port",       "REST4GIT_REUSE_PORT",       "1 to accept on every network thread (SO_REUSEPORT)" },
+};
+
+std::string trim(const std::string& s)
+{
+  const size_t begin = s.find_first_not_of(" \t\r");
+  if (begin == std::string::npos)
+  {
+    return std::string();
+  }
+  return s.substr(begin, s.find_last_not_of(" \t\r") - begin + 1);
+}
+
+bool parse_size(const std::string& value, size_t max, size_t& out)
+{
+  if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos)
+  {
+    return false;
+  }
+  errno = 0;
+  const unsigned long long n = strtoull(value.c_str(), nullptr, 10);
+  if (errno != 0 || n > max)
+  {
+    return false;
+  }
+  out = static_cast<size_t>(n);
+  return true;
+}
+
+bool read_line(const std::string& path, std::string& line)
+{
+  std::ifstream in(path);
+  return static_cast<bool>(std::getline(in, line));
+}
+
+/// CPUs granted by the cgroup quota, 0 if there is none.
+size_t cgroup_cpus()
+{
+  // Lines are "<id>:<controllers>:<path>", the cgroup v2 one is "0::<path>".
+  // Inside a container the path is usually the root of the mount.
+  std::string v2;
+  std::string v1;
+  std::ifstream cgroup("/proc/self/cgroup");
+  for (std::string line; std::getline(cgroup, line);)
+  {
+    const size_t first = line.find(':');
+    const size_t second = line.find(':', first + 1);
+    if (first == std::string::npos || second == std::string::npos)
+    {
+      continue;
+    }
+    const std::string controllers = "," + line.substr(first + 1, second - first - 1) + ",";
+    if (controllers == ",,")
+    {
+      v2 = line.substr(second + 1);
+    }
+    else if (controllers.find(",cpu,") != std::string::npos)
+    {
+      v1 = line.substr(second + 1);
+    }
+  }
+
+  // cgroup v2: "<quota> <period>" or "max <period>".
+  std::string line;
+  if ((!v2.empty() && read_line("/sys/fs/cgroup" + v2 + "/cpu.max", line)) ||
+      read_line("/sys/fs/cgroup/cpu.max", line))
+  {
+    std::istringstream is(line);
+    std::string quota;
+    double period = 0;
+    is >> quota >> period;
+    if (quota == "max" || period <= 0)
+    {
+      return 0;
+    }
+    return static_cast<size_t>(std::ceil(atof(quota.c_str()) / period));
+  }
+
+  // cgroup v1, a quota of -1 is unlimited.
+  std::string period;
+  const std::string dir = "/sys/fs/cgroup/cpu" + (v1 == "/" ? std::string() : v1);
+  if ((read_line(dir + "/cpu.cfs_quota_us", line) && read_line(dir + "/cpu.cfs_period_us", period)) ||
+      (read_line("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", line) &&
+       read_line("/sys/fs/cgroup/cpu/cpu.cfs_period_us", period)))
+  {
+    const double quota = atof(line.c_str());
+    const double length = atof(period.c_str());
+    if (quota > 0 && length > 0)
+    {
+      return static_cast<size_t>(std::ceil(quota / length));
+    }
+  }
+  return 0;
+}
+
+} // namespace
+
+ServerConfig::ServerConfig()
+  : port(DEFAULT_PORT)
+  , bindaddr(DEFAULT_BIND_ADDRESS)
+  , unix_socket_mode(DEFAULT_UNIX_SOCKET_MODE)
+  , io_threads(0)
+  , git_workers(0)
+  , git_queue(0)
+  , connection_pool(DEFAULT_CONNECTION_POOL)
+  , reuse_port(false)
+  , help(false)
+{
+}
+
+bool ServerConfig::load(int argc, char* argv[], std::string& error)
+{
+  for (const Option& option : OPTIONS)
+  {
+    const char* value = std::getenv(option.env);
+    if (value != nullptr && !set(option.key, value, error))
+    {
+      error = std::string(option.env) + ": " + error;
+      return false;
+    }
+  }
+
+  std::vector<std::pair<std::string, std::string>> options;
+  for (int i = 1; i < argc; ++i)
+  {
+    const std::string arg = argv[i];
+    if (arg == "-h" || arg == "--help")
+    {
+      help = true;
+      return true;
+    }
+    if (arg.compare(0, 2, "--") != 0)
+    {
+      error = "unexpected argument " + arg;
+      return false;
+    }
+    const size_t eq = arg.find('=');
+    std::string key = arg.substr(2, eq == std::string::npos ? std::string::npos : eq - 2);
+    std::string value;
+    if (eq != std::string::npos)
+    {
+      value = arg.substr(eq + 1);
+    }
+    else if (key == "reuse-port")
+    {
+      value = "1";
+    }
+    else if (i + 1 < argc)
+    {
+      value = argv[++i];
+    }
+    else
+    {
+      error = "missing value of --" + key;
+      return false;
+    }
+
+    // The file goes first, options on the command line override it.
+    if (key == "config")
+    {
+      if (!load_file(value, error))
+      {
+        return false;
+      }
+      continue;
+    }
+    options.emplace_back(key, value);
+  }
+
+  for (const auto& option : options)
+  {
+    if (!set(option.first, option.second, error))
+    {
+      error = "--" + option.first + ": " + error;
+      return false;
+    }
+  }
+  return true;
+}
+
+void ServerConfig::usage(std::ostream& os)
+{
+  os << "Usage: rest4git [--config <file>] [--<key> <value>]...\n\n"
+     << "Keys, also read from a config file as \"key = value\" lines and from the environment:\n";
+  for (const Option& option : OPTIONS)
+  {
+    os << "  --" << std::left << std::setw(18) << option.key << std::setw(27) << option.env
+       << option.help << "\n";
+  }
+}
+
+bool ServerConfig::set(const std::string& key, const std::string& value, std::string& error)
+{
+  size_t n = 0;
+  bool ok = true;
+  if (key == "port")
+  {
+    ok = parse_size(value, 65535, n) && n > 0;
+    port = static_cast<uint16_t>(n);
+  }
+  else if (key == "bind")
+  {
+    boost::system::error_code ec;
+    boost::asio::ip::address::from_string(value, ec);
+    ok = !ec;
+    bindaddr = value;
+  }
+  else if (key == "unix-socket")
+  {
+    // sun_path holds 107 characters and the terminating zero.
+    ok = !value.empty() && value.size() < 108;
+    unix_socket = value;
+  }
+  else if (key == "unix-socket-mode")
+  {
+    ok = !value.empty() && value.size() <= 4 && value.find_first_not_of("01234567") == std::string::npos;
+    unix_socket_mode = static_cast<mode_t>(ok ? std::stoul(value, nullptr, 8) : 0);
+  }
+  else if (key == "repo")
+  {
+    ok = !value.empty();
+    repo = value;
+  }
+  else if (key == "io-threads")
+  {
+    // crow counts its threads in 16 bits.
+    ok = parse_size(value, 1024, io_threads);
+  }
+  else if (key == "git-workers")
+  {
+    ok = parse_size(value, 1024, git_workers);
+  }
+  else if (key == "git-queue")
+  {
+    ok = parse_size(value, 1 << 24, git_queue);
+  }
+  else if (key == "connection-pool")
+  {
+    ok = parse_size(value, 1 << 16, connection_pool);
+  }
+  else if (key == "io-cpus")
+  {
+    ok = parse_cpu_list(value, io_cpus);
+  }
+  else if (key == "git-cpus")
+  {
+    ok = parse_cpu_list(value, git_cpus);
+  }
+  else if (key == "reuse-port")
+  {
+    ok = parse_size(value, 1, n);
+    reuse_port = (n != 0);
+  }
+  else
+  {
+    error = "unknown key " + key;
+    return false;
+  }
+
+  if (!ok)
+  {
+    error = "invalid value " + value;
+  }
+  return ok;
+}
+
+bool ServerConfig::load_file(const std::string& path, std::string& error)
+{
+  std::ifstream in(path);
+  if (!in)
+  {
+    error = "cannot read " + path;
+    return false;
+  }
+
+  size_t number = 0;
+  for (std::string line; std::getline(in, line);)
+  {
+    ++number;
+    line = trim(line.substr(0, line.find('#')));
+    if (line.empty())
+    {
+      continue;
+    }
+    const size_t eq = line.find('=');
+    if (eq == std::string::npos || !set(trim(line.substr(0, eq)), trim(line.substr(eq + 1)), error))
+    {
+      error = path + ":" + std::to_string(number) + ": " + (eq == std::string::npos ? "expected key = value" : error);
+      return false;
+    }
+  }
+  return true;
+}
+
+size_t available_cpus()
+{
+  size_t cpus = std::max(1u, std::thread::hardware_concurrency());
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0)
+  {
+    cpus = std::max(1, CPU_COUNT(&set));
+  }
+  const size_t quota = cgroup_cpus();
+  return quota > 0 ? std::min(cpus, quota) : cpus;
+}
+
+bool parse_cpu_list(const std::string& list, std::vector<int>& cpus)
+{
+  std::vector<int> parsed;
+  std::istringstream is(list);
+  for (std::string range; std::getline(is, range, ',');)
+  {
+    range = trim(range);
+    const size_t dash = range.find('-');
+    size_t first = 0;
+    size_t last = 0;
+    if (!parse_size(range.substr(0, dash), MAX_CPUS - 1, first) ||
+        !parse_size(dash == std::string::npos ? range : range.substr(dash + 1), MAX_CPUS - 1, last) ||
+        last < first)
+    {
+      return false;
+    }
+    for (size_t cpu = first; cpu <= last; ++cpu)
+    {
+      parsed.push_back(static_cast<int>(cpu));
+    }
+  }
+  if (parsed.empty())
+  {
+    return false;
+  }
+  cpus.swap(parsed);
+  return true;
+}
+
+std::string format_cpu_list(const std::vector<int>& cpus)
+{
+  std::string out;
+  for (size_t i = 0; i < cpus.size(); ++i)
+  {
+    size_t j = i;
+    while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+    {
+      ++j;
+    }
+    out += (out.empty() ? "" : ",") + std::to_string(cpus[i]);
+    if (j > i)
+    {
+      out += "-" + std::to_string(cpus[j]);
+    }
+    i = j;
+  }
+  return out;
+}
+
+bool pin_thread(const std::vector<int>& cpus)
+{
+  if (cpus.empty())
+  {
+    return true;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus)
+  {
+    CPU_SET(cpu, &set);
+  }
+  if (sched_setaffinity(0, sizeof(set), &set) != 0)
+  {
+    CROW_LOG_ERROR << "sched_setaffinity(" << format_cpu_list(cpus) << ") failed: " << strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+void set_openmp_threads(size_t threads)
+{
+  g_openmp_threads = threads;
+  limit_openmp();
+}
+
+void limit_openmp()
+{
+#ifdef _OPENMP
+  const size_t threads = g_openmp_threads;
+  if (threads > 0)
+  {
+    omp_set_num_threads(static_cast<int>(threads));
+  }
+#endif
+}
+
+} // rest4git
@@ -0,0 +1,79 @@
+/// \file server_config.h
+/// \brief Runtime configuration of the rest4git server.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// Every setting comes from its REST4GIT_* environment variable, a config
+/// file of "key = value" lines or the command line, in increasing order of
+/// precedence. Thread counts default to the CPUs the process may use, i.e.
+/// the cgroup CPU quota of a container rather than the cores of the host.
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace rest4git
+{
+
+const uint16_t DEFAULT_PORT = 8000;
+const char* const DEFAULT_BIND_ADDRESS = "0.0.0.0";
+/// Owner and group may connect to the Unix domain socket.
+const mode_t DEFAULT_UNIX_SOCKET_MODE = 0660;
+/// Closed connections each network thread keeps for reuse.
+const size_t DEFAULT_CONNECTION_POOL = 256;
+
+struct ServerConfig
+{
+  uint16_t port;
+  std::string bindaddr;
+  /// Unix domain socket served next to the TCP port, empty for none.
+  std::string unix_socket;
+  mode_t unix_socket_mode;
+  /// Repository to serve, empty for the working directory.
+  std::string repo;
+  /// Network threads, 0 for one per available CPU.
+  size_t io_threads;
+  /// Git worker threads, 0 for one per available CPU.
+  size_t git_workers;
+  /// Queued git tasks, 0 for the pool default.
+  size_t git_queue;
+  /// Closed connections kept per network thread, 0 for none.
+  size_t connection_pool;
+  /// CPUs network threads are pinned to, one each, empty for no pinning.
+  std::vector<int> io_cpus;
+  /// CPUs the git workers and their OpenMP threads share.
+  std::vector<int> git_cpus;
+  bool reuse_port;
+  bool help;
+
+  explicit ServerConfig();
+  /// Reads the environment, then the file named by --config, then the
+  /// options. False with \p error set on an unknown key or a bad value.
+  bool load(int argc, char* argv[], std::string& error);
+  static void usage(std::ostream& os);
+private:
+  bool set(const std::string& key, const std::string& value, std::string& error);
+  bool load_file(const std::string& path, std::string& error);
+};
+
+/// CPUs the process may run on: the affinity mask, further limited by the
+/// cgroup CPU quota rounded up.
+size_t available_cpus();
+/// Parses a list like "0-3,8,10-11".
+bool parse_cpu_list(const std::string& list, std::vector<int>& cpus);
+std::string format_cpu_list(const std::vector<int>& cpus);
+/// Restricts the calling thread to \p cpus, nothing if empty.
+bool pin_thread(const std::vector<int>& cpus);
+/// Sets the OpenMP team size of the calling thread and the one applied by
+/// limit_openmp(). OpenMP keeps it per thread: a new std::thread starts
+/// with the default of one thread per CPU of the host.
+void set_openmp_threads(size_t threads);
+/// Applies the size of set_openmp_threads() to the calling thread.
+void limit_openmp();
+
+} // rest4git
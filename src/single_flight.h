@@ -0,0 +1,101 @@
+/// \file single_flight.h
+/// \brief Coalescing of identical in-flight computations for rest4git.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// The first caller of a key leads the flight and computes the value, any
+/// caller arriving before it is done only registers a waiter. complete()
+/// hands the one value to every waiter, so a burst of identical requests
+/// costs a single computation.
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "singleton.h"
+
+namespace rest4git
+{
+
+struct FlightStats
+{
+  uint64_t flights;
+  uint64_t coalesced;
+  size_t in_flight;
+};
+
+template <typename V>
+class SingleFlight : public Notcopyable
+{
+public:
+  typedef std::function<void(const V&)> Waiter;
+
+  explicit SingleFlight()
+    : m_flights(0)
+    , m_coalesced(0)
+  {
+  }
+
+  /// Registers \p waiter for \p key. Returns true if the caller leads the
+  /// flight and must call complete() for \p key, also on failure.
+  bool join(const std::string& key, Waiter waiter)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto found = m_waiters.find(key);
+    if (found != m_waiters.end())
+    {
+      found->second.push_back(std::move(waiter));
+      m_coalesced++;
+      return false;
+    }
+    m_waiters[key].push_back(std::move(waiter));
+    m_flights++;
+    return true;
+  }
+
+  /// Ends the flight of \p key, waiters are called outside the lock.
+  void complete(const std::string& key, const V& value)
+  {
+    std::vector<Waiter> waiters;
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto found = m_waiters.find(key);
+      if (found == m_waiters.end())
+      {
+        return;
+      }
+      waiters.swap(found->second);
+      m_waiters.erase(found);
+    }
+    for (auto& waiter : waiters)
+    {
+      waiter(value);
+    }
+  }
+
+  FlightStats stats() const
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    FlightStats s;
+    s.flights = m_flights;
+    s.coalesced = m_coalesced;
+    s.in_flight = m_waiters.size();
+    return s;
+  }
+
+private:
+  mutable std::mutex m_mutex;
+  std::unordered_map<std::string, std::vector<Waiter>> m_waiters;
+  std::atomic<uint64_t> m_flights;
+  std::atomic<uint64_t> m_coalesced;
+};
+
+} // rest4git
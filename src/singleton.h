@@ -6,6 +6,8 @@
 /// Currently there is no detailed description available.
 /// \todo Add more detailed description!
 
+#pragma once
+
 namespace rest4git
 {
 
@@ -14,6 +14,7 @@
 #include <memory>
 #include <string>
 #include <array>
+#include <sys/stat.h>
 
 const unsigned int MAX_CHAR = 262144;
 
@@ -44,9 +45,9 @@ public:
 
   static bool file_exists(const std::string& path)
   {
-    std::string p = "[ -f " + path + " ] && echo '1' || echo '0'";
-    std::string res = rest4git::SysCmd::execute(p);
-    return (res == "1\n") ? true : false;
+    // Same as [ -f path ], without spawning a shell
+    struct stat st;
+    return ::stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode);
   }
 };
 
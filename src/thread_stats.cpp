@@ -0,0 +1,143 @@
+/// \file thread_stats.cpp
+/// \brief Implementation for rest4git::ThreadStats.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// Implementation for the per-thread CPU utilisation
+///
+
+#include <fstream>
+#include <iomanip>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "thread_stats.h"
+#include "server_config.h"
+
+namespace rest4git
+{
+
+namespace
+{
+
+/// Share of one CPU used between two samples in percent.
+double busy(uint64_t ticks, double ticks_per_second, std::chrono::steady_clock::duration elapsed)
+{
+  const double seconds = std::chrono::duration<double>(elapsed).count();
+  return seconds > 0 ? 100.0 * ticks / ticks_per_second / seconds : 0.0;
+}
+
+} // namespace
+
+ThreadStats& ThreadStats::get_instance()
+{
+  static ThreadStats instance;
+  return instance;
+}
+
+ThreadStats::ThreadStats()
+  : m_ticks_per_second(static_cast<double>(sysconf(_SC_CLK_TCK)))
+{
+}
+
+void ThreadStats::add(const std::string& name)
+{
+  Entry entry;
+  entry.name = name;
+  entry.tid = static_cast<int>(syscall(SYS_gettid));
+  int cpu = 0;
+  if (!read(entry.tid, entry.start, cpu))
+  {
+    return;
+  }
+  entry.last = entry.start;
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if (sched_getaffinity(0, sizeof(set), &set) == 0)
+  {
+    std::vector<int> cpus;
+    for (int i = 0; i < CPU_SETSIZE; ++i)
+    {
+      if (CPU_ISSET(i, &set))
+      {
+        cpus.push_back(i);
+      }
+    }
+    entry.cpus = format_cpu_list(cpus);
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_entries.push_back(entry);
+}
+
+void ThreadStats::print_stats(std::stringstream& ss)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  ss << std::left << std::setw(12) << "thread" << std::setw(8) << "tid" << std::setw(5) << "cpu"
+     << std::setw(12) << "allowed" << std::right << std::setw(8) << "total" << std::setw(8) << "recent"
+     << std::setw(10) << "cpu time" << "\n";
+  for (Entry& entry : m_entries)
+  {
+    Sample now;
+    int cpu = 0;
+    ss << std::left << std::setw(12) << entry.name << std::setw(8) << entry.tid;
+    if (!read(entry.tid, now, cpu))
+    {
+      ss << "exited\n";
+      continue;
+    }
+    ss << std::setw(5) << cpu << std::setw(12) << (entry.cpus.empty() ? "-" : entry.cpus)
+       << std::right << std::fixed << std::setprecision(1)
+       << std::setw(7) << busy(now.ticks - entry.start.ticks, m_ticks_per_second, now.time - entry.start.time) << "%"
+       << std::setw(7) << busy(now.ticks - entry.last.ticks, m_ticks_per_second, now.time - entry.last.time) << "%"
+       << std::setw(9) << (now.ticks - entry.start.ticks) / m_ticks_per_second << "s\n";
+    entry.last = now;
+  }
+  ss.unsetf(std::ios_base::floatfield);
+  ss << std::setprecision(6) << std::left;
+}
+
+bool ThreadStats::read(int tid, Sample& sample, int& cpu)
+{
+  std::ifstream in("/proc/self/task/" + std::to_string(tid) + "/stat");
+  std::string line;
+  if (!std::getline(in, line))
+  {
+    return false;
+  }
+  sample.time = std::chrono::steady_clock::now();
+
+  // The name in parentheses may hold spaces, the fields after it do not:
+  // state is field 3, utime 14, stime 15 and processor 39.
+  const std::string::size_type paren = line.rfind(')');
+  if (paren == std::string::npos)
+  {
+    return false;
+  }
+  std::istringstream fields(line.substr(paren + 2));
+  std::string field;
+  uint64_t utime = 0;
+  uint64_t stime = 0;
+  for (int i = 3; i <= 39 && fields >> field; ++i)
+  {
+    if (i == 14)
+    {
+      utime = std::stoull(field);
+    }
+    else if (i == 15)
+    {
+      stime = std::stoull(field);
+    }
+    else if (i == 39)
+    {
+      cpu = std::stoi(field);
+    }
+  }
+  sample.ticks = utime + stime;
+  return true;
+}
+
+} // rest4git
@@ -0,0 +1,57 @@
+/// \file thread_stats.h
+/// \brief CPU utilisation of the rest4git server threads.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// The io threads and git workers register themselves as they start.
+/// print_stats() reads their user and system time from /proc and reports
+/// the share of one CPU each used since it started and since the previous
+/// report, next to the CPU it last ran on and the CPUs it may use.
+
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "singleton.h"
+
+namespace rest4git
+{
+
+class ThreadStats : public Notcopyable
+{
+public:
+  static rest4git::ThreadStats& get_instance();
+public:
+  /// Registers the calling thread as \p name.
+  void add(const std::string& name);
+  void print_stats(std::stringstream& ss);
+private:
+  struct Sample
+  {
+    std::chrono::steady_clock::time_point time;
+    /// User plus system time in clock ticks.
+    uint64_t ticks;
+  };
+  struct Entry
+  {
+    std::string name;
+    int tid;
+    std::string cpus;
+    Sample start;
+    Sample last;
+  };
+  explicit ThreadStats();
+  /// Reads /proc/self/task/<tid>/stat, false once the thread is gone.
+  static bool read(int tid, Sample& sample, int& cpu);
+private:
+  std::mutex m_mutex;
+  std::vector<Entry> m_entries;
+  const double m_ticks_per_second;
+};
+
+} // rest4git
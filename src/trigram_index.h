@@ -0,0 +1,206 @@
+/// \file trigram_index.h
+/// \brief Trigram index over the file paths of one HEAD tree for rest4git.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// Every path is split into its overlapping three byte sequences. The
+/// postings (path ids per trigram) are stored in one array with row
+/// offsets, so a substring query only verifies the paths holding all of
+/// the pattern's trigrams. Paths are numbered in byte order, the order
+/// of the git index.
+
+#pragma once
+#ifdef LIBGIT2_AVAILABLE
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <git2.h>
+#include "path_index.h"
+#include "utils.h"
+
+namespace rest4git
+{
+
+class TrigramIndex
+{
+public:
+  static std::shared_ptr<const TrigramIndex> build(const PathIndex& paths)
+  {
+    std::vector<const std::string*> sorted;
+    sorted.reserve(paths.size());
+    for (const auto& entry : paths.entries())
+    {
+      sorted.push_back(&entry.first);
+    }
+    std::sort(sorted.begin(), sorted.end(),
+      [](const std::string* a, const std::string* b) { return *a < *b; });
+
+    std::shared_ptr<TrigramIndex> index = std::make_shared<TrigramIndex>();
+    index->m_head = paths.head();
+    index->m_offsets.reserve(sorted.size() + 1);
+    for (const auto* path : sorted)
+    {
+      index->m_offsets.push_back(static_cast<uint32_t>(index->m_names.size()));
+      index->m_names += *path;
+    }
+    index->m_offsets.push_back(static_cast<uint32_t>(index->m_names.size()));
+
+    // Count the paths per trigram, then fill the rows in path order.
+    std::unordered_map<uint32_t, uint32_t> rows;
+    std::vector<uint32_t> grams;
+    for (uint32_t id = 0; id < index->size(); ++id)
+    {
+      index->trigrams_of(id, grams);
+      for (uint32_t g : grams)
+      {
+        rows[g]++;
+      }
+    }
+
+    index->m_keys.reserve(rows.size());
+    for (const auto& row : rows)
+    {
+      index->m_keys.push_back(row.first);
+    }
+    std::sort(index->m_keys.begin(), index->m_keys.end());
+    index->m_rows.resize(index->m_keys.size() + 1, 0);
+    for (size_t k = 0; k < index->m_keys.size(); ++k)
+    {
+      uint32_t& next = rows[index->m_keys[k]];
+      index->m_rows[k + 1] = index->m_rows[k] + next;
+      next = index->m_rows[k];
+    }
+
+    index->m_postings.resize(index->m_rows.back());
+    for (uint32_t id = 0; id < index->size(); ++id)
+    {
+      index->trigrams_of(id, grams);
+      for (uint32_t g : grams)
+      {
+        index->m_postings[rows[g]++] = id;
+      }
+    }
+    return index;
+  }
+
+  const git_oid& head() const
+  {
+    return m_head;
+  }
+
+  uint32_t size() const
+  {
+    return static_cast<uint32_t>(m_offsets.size() - 1);
+  }
+
+  const char* path(uint32_t id, size_t& len) const
+  {
+    len = m_offsets[id + 1] - m_offsets[id];
+    return m_names.data() + m_offsets[id];
+  }
+
+  /// Calls \p f with the id of every path containing \p pattern, in path
+  /// order, until \p f returns false. An empty pattern matches every path.
+  template <typename F>
+  void search(const std::string& pattern, F f) const
+  {
+    if (pattern.size() < 3)
+    {
+      // Too short for a trigram, scan everything.
+      for (uint32_t id = 0; id < size(); ++id)
+      {
+        if ((pattern.empty() || matches(id, pattern)) && !f(id))
+        {
+          return;
+        }
+      }
+      return;
+    }
+
+    std::vector<std::pair<const uint32_t*, const uint32_t*>> lists;
+    std::vector<uint32_t> grams;
+    collect_trigrams(pattern.data(), pattern.size(), grams);
+    for (uint32_t g : grams)
+    {
+      auto key = std::lower_bound(m_keys.begin(), m_keys.end(), g);
+      if (key == m_keys.end() || *key != g)
+      {
+        return;
+      }
+      const size_t k = key - m_keys.begin();
+      lists.push_back(std::make_pair(m_postings.data() + m_rows[k], m_postings.data() + m_rows[k + 1]));
+    }
+    std::sort(lists.begin(), lists.end(),
+      [](const std::pair<const uint32_t*, const uint32_t*>& a, const std::pair<const uint32_t*, const uint32_t*>& b)
+      { return (a.second - a.first) < (b.second - b.first); });
+
+    // Walk the shortest list, the others only move forward.
+    for (const uint32_t* it = lists[0].first; it != lists[0].second; ++it)
+    {
+      bool all = true;
+      for (size_t l = 1; l < lists.size() && all; ++l)
+      {
+        lists[l].first = std::lower_bound(lists[l].first, lists[l].second, *it);
+        all = (lists[l].first != lists[l].second && *lists[l].first == *it);
+      }
+      if (all && matches(*it, pattern) && !f(*it))
+      {
+        return;
+      }
+    }
+  }
+
+  size_t weight() const
+  {
+    return m_names.capacity() + (m_offsets.capacity() + m_keys.capacity() +
+      m_rows.capacity() + m_postings.capacity()) * sizeof(uint32_t);
+  }
+
+private:
+  static void collect_trigrams(const char* s, size_t len, std::vector<uint32_t>& grams)
+  {
+    grams.clear();
+    for (size_t i = 0; i + 3 <= len; ++i)
+    {
+      grams.push_back((static_cast<uint32_t>(static_cast<unsigned char>(s[i])) << 16) |
+                      (static_cast<uint32_t>(static_cast<unsigned char>(s[i + 1])) << 8) |
+                      static_cast<uint32_t>(static_cast<unsigned char>(s[i + 2])));
+    }
+    std::sort(grams.begin(), grams.end());
+    grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+  }
+
+  void trigrams_of(uint32_t id, std::vector<uint32_t>& grams) const
+  {
+    size_t len = 0;
+    const char* s = path(id, len);
+    collect_trigrams(s, len, grams);
+  }
+
+  bool matches(uint32_t id, const std::string& pattern) const
+  {
+    size_t len = 0;
+    const char* s = path(id, len);
+    return Utils::search(s, len, pattern.data(), pattern.size()) != nullptr;
+  }
+
+private:
+  git_oid m_head;
+  std::string m_names;
+  std::vector<uint32_t> m_offsets;
+  /// Sorted trigrams, row k of the postings is m_rows[k] .. m_rows[k + 1].
+  std::vector<uint32_t> m_keys;
+  std::vector<uint32_t> m_rows;
+  std::vector<uint32_t> m_postings;
+};
+
+typedef std::shared_ptr<const TrigramIndex> TrigramIndexPtr;
+
+} // rest4git
+
+#endif // LIBGIT2_AVAILABLE
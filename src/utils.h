@@ -9,11 +9,15 @@
 
 #pragma once
 #include <cstddef>
+#include <cstdint>
 #include <cstdio>
 #include <cstring>
 #include <string>
 #include <unistd.h>
 #include <stdio.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 #include "syscmd.h"
 
@@ -44,9 +48,69 @@ class Utils
         return std::string::npos;
       }
 
-      auto found = std::strstr(str.c_str() + start, substr.c_str());
+      const char* found = search(str.data() + start, str.size() - start, substr.data(), substr.size());
       return (found == nullptr ? 
-        std::string::npos : std::string::size_type(found - str.c_str()));
+        std::string::npos : std::string::size_type(found - str.data()));
+    }
+
+    /// Substring search comparing the first and last needle character at
+    /// 32 (AVX2) or 16 (SSE2) positions at once, only candidates get a memcmp.
+    static const char* search(const char* str, size_t size, const char* substr, size_t subsize)
+    {
+      if (subsize == 0 || subsize > size)
+      {
+        return nullptr;
+      }
+
+      const size_t last = subsize - 1;
+      size_t i = 0;
+#if defined(__AVX2__)
+      const __m256i first_char = _mm256_set1_epi8(substr[0]);
+      const __m256i last_char = _mm256_set1_epi8(substr[last]);
+      for (; i + last + 32 <= size; i += 32)
+      {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(str + i + last));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(
+          _mm256_and_si256(_mm256_cmpeq_epi8(a, first_char), _mm256_cmpeq_epi8(b, last_char))));
+        while (mask)
+        {
+          const size_t pos = i + __builtin_ctz(mask);
+          if (std::memcmp(str + pos + 1, substr + 1, subsize > 2 ? subsize - 2 : 0) == 0)
+          {
+            return str + pos;
+          }
+          mask &= mask - 1;
+        }
+      }
+#elif defined(__SSE2__)
+      const __m128i first_char = _mm_set1_epi8(substr[0]);
+      const __m128i last_char = _mm_set1_epi8(substr[last]);
+      for (; i + last + 16 <= size; i += 16)
+      {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i + last));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(
+          _mm_and_si128(_mm_cmpeq_epi8(a, first_char), _mm_cmpeq_epi8(b, last_char))));
+        while (mask)
+        {
+          const size_t pos = i + __builtin_ctz(mask);
+          if (std::memcmp(str + pos + 1, substr + 1, subsize > 2 ? subsize - 2 : 0) == 0)
+          {
+            return str + pos;
+          }
+          mask &= mask - 1;
+        }
+      }
+#endif
+      for (; i + last < size; ++i)
+      {
+        if (str[i] == substr[0] && std::memcmp(str + i + 1, substr + 1, last) == 0)
+        {
+          return str + i;
+        }
+      }
+      return nullptr;
     }
 };
 
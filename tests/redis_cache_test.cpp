@@ -0,0 +1,263 @@
+/// \file redis_cache_test.cpp
+/// \brief Tests rest4git::RedisCache against a local redis-server.
+/// \author Juniarto Saputra (jsaputra@riseup.net)
+/// \version 1.0
+/// \date Oct 2026
+///
+/// Starts redis-server on a free port and checks misses, hits, SET EX,
+/// the order of pipelined replies and the fallback once the server hangs
+/// or is gone. Exits with 77, reported as skipped, without redis-server.
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <future>
+#include <iostream>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "redis_cache.h"
+
+namespace
+{
+
+const int SKIP = 77;
+const uint32_t TIMEOUT_MS = 200;
+const uint32_t TTL_SECONDS = 100;
+const size_t PIPELINED_KEYS = 200;
+
+int g_failures = 0;
+
+#define CHECK(cond) \
+  do \
+  { \
+    if (!(cond)) \
+    { \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #cond ") failed" << std::endl; \
+      g_failures++; \
+    } \
+  } while (0)
+
+typedef std::chrono::steady_clock Clock;
+
+long elapsed_ms(Clock::time_point since)
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - since).count();
+}
+
+bool wait_until(const std::function<bool()>& done, int timeout_ms = 5000)
+{
+  const Clock::time_point start = Clock::now();
+  while (!done())
+  {
+    if (elapsed_ms(start) > timeout_ms)
+    {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return true;
+}
+
+int free_port()
+{
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  int port = 0;
+  if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 &&
+      ::getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) == 0)
+  {
+    port = ntohs(addr.sin_port);
+  }
+  ::close(fd);
+  return port;
+}
+
+int connect_to(int port)
+{
+  int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+  {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+/// Sends one command and returns the first line of the reply, e.g. ":97".
+std::string command(int port, const std::vector<std::string>& args)
+{
+  int fd = connect_to(port);
+  if (fd < 0)
+  {
+    return std::string();
+  }
+  std::string cmd = "*" + std::to_string(args.size()) + "\r\n";
+  for (const auto& arg : args)
+  {
+    cmd += "$" + std::to_string(arg.size()) + "\r\n" + arg + "\r\n";
+  }
+  std::string reply;
+  if (::write(fd, cmd.data(), cmd.size()) == static_cast<ssize_t>(cmd.size()))
+  {
+    char c;
+    while (::read(fd, &c, 1) == 1 && c != '\r')
+    {
+      reply += c;
+    }
+  }
+  ::close(fd);
+  return reply;
+}
+
+pid_t start_server(const std::string& binary, int port)
+{
+  const pid_t pid = ::fork();
+  if (pid == 0)
+  {
+    int null = ::open("/dev/null", O_WRONLY);
+    ::dup2(null, STDOUT_FILENO);
+    const std::string p = std::to_string(port);
+    ::execl(binary.c_str(), binary.c_str(), "--port", p.c_str(), "--bind", "127.0.0.1",
+            "--save", "", "--appendonly", "no", static_cast<char*>(nullptr));
+    ::_exit(127);
+  }
+  if (pid < 0 || !wait_until([port] { return command(port, {"PING"}) == "+PONG"; }))
+  {
+    return -1;
+  }
+  return pid;
+}
+
+void stop_server(pid_t pid)
+{
+  ::kill(pid, SIGKILL);
+  ::waitpid(pid, nullptr, 0);
+}
+
+void test_get_set(rest4git::RedisCache& cache, int port)
+{
+  std::string value;
+  CHECK(!cache.get("missing", value));
+  CHECK(cache.stats().misses == 1);
+
+  // Values may hold CRLF and zero bytes.
+  const std::string stored("line 1\r\nline 2\0end", 18);
+  cache.set_async("key", stored);
+  CHECK(wait_until([&cache] { return cache.stats().stores == 1; }));
+
+  const std::string ttl = command(port, {"TTL", "key"});
+  CHECK(!ttl.empty() && ttl[0] == ':');
+  const long seconds = ttl.empty() ? 0 : std::stol(ttl.substr(1));
+  CHECK(seconds > 0 && seconds <= static_cast<long>(TTL_SECONDS));
+
+  CHECK(cache.get("key", value));
+  CHECK(value == stored);
+  CHECK(cache.stats().hits == 1);
+}
+
+void test_pipelined_order(rest4git::RedisCache& cache)
+{
+  const uint64_t stores = cache.stats().stores;
+  for (size_t i = 0; i < PIPELINED_KEYS; ++i)
+  {
+    cache.set_async("order:" + std::to_string(i), "value " + std::to_string(i));
+  }
+  CHECK(wait_until([&] { return cache.stats().stores == stores + PIPELINED_KEYS; }));
+
+  // Queued back to back, so the worker sends them in few batches. Every
+  // third key does not exist and must stay a miss at its own position.
+  std::vector<std::future<rest4git::RedisValue>> futures;
+  for (size_t i = 0; i < PIPELINED_KEYS; ++i)
+  {
+    futures.push_back(cache.get_async((i % 3 == 2 ? "absent:" : "order:") + std::to_string(i)));
+  }
+  for (size_t i = 0; i < PIPELINED_KEYS; ++i)
+  {
+    rest4git::RedisValue value = futures[i].get();
+    if (i % 3 == 2)
+    {
+      CHECK(!value);
+    }
+    else
+    {
+      CHECK(value && *value == "value " + std::to_string(i));
+    }
+  }
+}
+
+void test_fallback(rest4git::RedisCache& cache, pid_t pid)
+{
+  // A hanging server costs a lookup the timeout, not more.
+  ::kill(pid, SIGSTOP);
+  std::string value;
+  Clock::time_point start = Clock::now();
+  CHECK(!cache.get("key", value));
+  long ms = elapsed_ms(start);
+  CHECK(ms >= static_cast<long>(TIMEOUT_MS) - 5 && ms < 3 * static_cast<long>(TIMEOUT_MS));
+  CHECK(cache.stats().timeouts == 1);
+
+  // A server that is gone answers every lookup with a miss.
+  ::kill(pid, SIGCONT);
+  stop_server(pid);
+  for (int i = 0; i < 5; ++i)
+  {
+    start = Clock::now();
+    CHECK(!cache.get("key", value));
+    CHECK(elapsed_ms(start) < 3 * static_cast<long>(TIMEOUT_MS));
+  }
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  const std::string binary = (argc > 1) ? argv[1] : "";
+  if (binary.empty() || ::access(binary.c_str(), X_OK) != 0)
+  {
+    std::cout << "redis-server not found, skipped" << std::endl;
+    return SKIP;
+  }
+
+  const int port = free_port();
+  const pid_t pid = start_server(binary, port);
+  if (pid < 0)
+  {
+    std::cerr << "cannot start " << binary << " on port " << port << std::endl;
+    return 1;
+  }
+
+  {
+    rest4git::RedisCache cache;
+    CHECK(cache.start("127.0.0.1:" + std::to_string(port), TIMEOUT_MS, TTL_SECONDS));
+    test_get_set(cache, port);
+    test_pipelined_order(cache);
+    test_fallback(cache, pid);
+    cache.stop();
+  }
+
+  if (g_failures != 0)
+  {
+    std::cerr << g_failures << " checks failed" << std::endl;
+    return 1;
+  }
+  std::cout << "all checks passed" << std::endl;
+  return 0;
+}